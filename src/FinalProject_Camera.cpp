@@ -7,6 +7,9 @@
 #include <vector>
 #include <cmath>
 #include <limits>
+#include <algorithm>
+#include <memory>
+#include <cassert>
 #include <opencv2/core.hpp>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
@@ -19,6 +22,15 @@
 #include "objectDetection2D.hpp"
 #include "lidarData.hpp"
 #include "camFusion.hpp"
+#include "frameBuffer.hpp"
+#include "allocCounter.hpp"
+#include "threadPool.hpp"
+#include "renderer.hpp"
+#include "trackManager.hpp"
+#include "recording.hpp"
+#include "realTimeScheduler.hpp"
+#include "sensorStream.hpp"
+#include "framePipeline.hpp"
 
 using namespace std;
 
@@ -44,6 +56,8 @@ int main(int argc, const char *argv[])
     string yoloClassesFile = yoloBasePath + "coco.names";
     string yoloModelConfiguration = yoloBasePath + "yolov3.cfg";
     string yoloModelWeights = yoloBasePath + "yolov3.weights";
+    string yoloLightModelConfiguration = yoloBasePath + "yolov3-tiny.cfg"; // lighter model, used when running behind
+    string yoloLightModelWeights = yoloBasePath + "yolov3-tiny.weights";
 
     // Lidar
     string lidarPrefix = "KITTI/2011_09_26/velodyne_points/data/000000";
@@ -69,229 +83,278 @@ int main(int argc, const char *argv[])
     P_rect_00.at<double>(2,0) = 0.000000e+00; P_rect_00.at<double>(2,1) = 0.000000e+00; P_rect_00.at<double>(2,2) = 1.000000e+00; P_rect_00.at<double>(2,3) = 0.000000e+00;    
 
     // misc
-    double sensorFrameRate = 10.0 / imgStepWidth; // frames per second for Lidar and camera
+    double sensorRate = 10.0;     // frames per second delivered by Lidar and camera
+    double sensorFrameRate = sensorRate / imgStepWidth; // nominal rate of the processed frames
     int dataBufferSize = 2;       // no. of images which are held in memory (ring buffer) at the same time
-    vector<DataFrame> dataBuffer; // list of data frames which are held in memory at the same time
-    bool bVis = false;            // visualize results
+    FrameBuffer dataBuffer(dataBufferSize); // recycled frame slots which are held in memory at the same time
+    size_t allocCountFrameStart = 0; // heap allocation counter at the start of the current frame
+    size_t nSteadyFrames = 0, steadyAllocMin = 0, steadyAllocMax = 0, steadyAllocSum = 0; // allocations of frames after warm-up
+    ThreadPool threadPool(0);     // workers for per-object computations (0 = no. of hardware cores)
+
+    // per-frame processing stages (see framePipeline.hpp for the parameters which are not set here)
+    FramePipelineConfig pipelineConfig;
+    pipelineConfig.P_rect_xx = P_rect_00;
+    pipelineConfig.R_rect_xx = R_rect_00;
+    pipelineConfig.RT = RT;
+    pipelineConfig.nominalFrameRate = sensorFrameRate;
+    pipelineConfig.bFilterClusters = false; // opt-in, changes the Lidar TTC compared to the unfiltered box points
+    pipelineConfig.bLimitKpts = false;      // limit no. of keypoints (helpful for debugging and learning)
+    pipelineConfig.bVis = false;            // visualize intermediate results (blocks the pipeline)
+
+    // recording of intermediate results for replaying single stages in isolation (see replayStage.cpp)
+    bool bRecord = false;
+    string recordingFile = "pipeline.rec";
+    RecordingWriter recorder;
+    vector<LidarPoint> recordedLidarPoints; // input of clusterLidarWithROI, which reorders the frame's points
+    vector<cv::DMatch> recordedKptMatches;  // input of clusterKptMatchesWithROI, which reorders the frame's matches
+
+    // optional voxel-grid downsampling of the cropped Lidar cloud
+    pipelineConfig.bDownsample = false;
+    pipelineConfig.voxelLeafSize = 0.1; // edge length of a voxel in [m]
+    bool bReportDownsampling = false;  // additionally cluster the full cloud and report the Lidar TTC difference
+    vector<LidarPoint> fullLidarPointsPrev, fullLidarPointsCurr;     // full clouds, only used for the report
+    vector<BoundingBox> fullBoundingBoxesPrev, fullBoundingBoxesCurr; // boxes clustered with the full clouds
+    vector<cv::Point3f> fullLidarProjections;                        // image projections of the current full cloud
+
+    // visualization of final results on a separate thread
+    bool bRender = true;
+    RenderConfig renderConfig;
+    renderConfig.outputType = "WINDOW"; // WINDOW, VIDEO, IMAGES (VIDEO and IMAGES do not need a display)
+    renderConfig.outputPath = "ttc.avi"; // video file for VIDEO, existing directory for IMAGES
+    renderConfig.queueSize = 2;
+    renderConfig.frameRate = sensorFrameRate;
+    renderConfig.worldSize = cv::Size(4.0, 20.0);
+    renderConfig.topviewSize = cv::Size(2000, 2000);
+    std::unique_ptr<AsyncRenderer> renderer(bRender ? new AsyncRenderer(renderConfig) : nullptr);
+
+    // object detection networks are loaded once
+    ObjectDetector objectDetector(yoloClassesFile, yoloModelConfiguration, yoloModelWeights);
+    std::unique_ptr<ObjectDetector> lightObjectDetector;
+
+    // real-time mode : play the sequence at sensor rate, drop frames and degrade work to keep the latency bounded
+    bool bRealTime = false;
+    RealTimeConfig realTimeConfig;
+    realTimeConfig.sensorRate = sensorRate;
+    realTimeConfig.deadline = 1.0 / sensorFrameRate; // latency budget of each frame in [s]
+    realTimeConfig.recoverFraction = 0.5;
+    realTimeConfig.maxSkippedDetections = 2; // every third frame at least runs the light detector
+    pipelineConfig.maxKeypointsDegraded = 300; // keypoint budget from quality level REDUCED_KEYPOINTS on
+    if (bRealTime)
+    {
+        lightObjectDetector.reset(new ObjectDetector(yoloClassesFile, yoloLightModelConfiguration, yoloLightModelWeights));
+    }
+    RealTimeScheduler scheduler(realTimeConfig);
+    QualityLevel qualityLevel = QualityLevel::FULL;
+
+    // streaming input : receive timestamped camera images and Lidar scans from a local publisher (e.g. kitti_replayer)
+    // instead of reading numbered files; the publisher paces the frames, so real-time mode only applies to files
+    bool bStream = false;
+    string streamType = "UNIX_SOCKET";            // UNIX_SOCKET, FIFO
+    string streamPath = "/tmp/sfnd_sensors.sock";  // socket or named pipe, created by this program
+    string streamShmName = "/sfnd_camera";         // shared-memory image slots, created by the publisher
+    double maxSensorTimeOffset = 0.5 / sensorRate; // max. difference between camera and Lidar timestamp of a frame
+    SensorStreamReceiver sensorStream;
+    if (bStream)
+    {
+        bRealTime = false;
+        if (!sensorStream.open(streamType, streamPath, streamShmName, maxSensorTimeOffset, dataBufferSize))
+        {
+            return 1;
+        }
+    }
+
+    // file names are assembled in place and encoded images are read into a recycled buffer, so that they keep their
+    // capacity across frames
+    char imgNumber[32];
+    string imgFullFilename, lidarFullFilename;
+    vector<unsigned char> imgFileBuffer;
+
+    FramePipeline framePipeline(pipelineConfig, objectDetector, lightObjectDetector.get(), threadPool);
+    const FramePipelineConfig &config = framePipeline.getConfig();
+    const TrackManager &trackManager = framePipeline.getTrackManager();
+    FrameCaptures captures;
+    if (bRecord)
+    {
+        captures.lidarPointsIn = &recordedLidarPoints;
+        captures.kptMatchesIn = &recordedKptMatches;
+    }
+    if (bReportDownsampling)
+    {
+        captures.fullLidarPoints = &fullLidarPointsCurr;
+    }
 
     /* MAIN LOOP OVER ALL IMAGES */
 
-    for (size_t imgIndex = 0; imgIndex <= imgEndIndex - imgStartIndex; imgIndex+=imgStepWidth)
+    if (bRealTime)
     {
-        /* LOAD IMAGE INTO BUFFER */
-
-        // assemble filenames for current index
-        ostringstream imgNumber;
-        imgNumber << setfill('0') << setw(imgFillWidth) << imgStartIndex + imgIndex;
-        string imgFullFilename = imgBasePath + imgPrefix + imgNumber.str() + imgFileType;
-
-        // load image from file 
-        cv::Mat img = cv::imread(imgFullFilename);
-
-        // push image into data frame buffer
-        DataFrame frame;
-        frame.cameraImg = img;
-        dataBuffer.push_back(frame);
-
-        cout << "#1 : LOAD IMAGE INTO BUFFER done" << endl;
-
-
-        /* DETECT & CLASSIFY OBJECTS */
-
-        float confThreshold = 0.2;
-        float nmsThreshold = 0.4;        
-        detectObjects((dataBuffer.end() - 1)->cameraImg, (dataBuffer.end() - 1)->boundingBoxes, confThreshold, nmsThreshold,
-                      yoloBasePath, yoloClassesFile, yoloModelConfiguration, yoloModelWeights, bVis);
-
-        cout << "#2 : DETECT & CLASSIFY OBJECTS done" << endl;
-
-
-        /* CROP LIDAR POINTS */
-
-        // load 3D Lidar points from file
-        string lidarFullFilename = imgBasePath + lidarPrefix + imgNumber.str() + lidarFileType;
-        std::vector<LidarPoint> lidarPoints;
-        loadLidarFromFile(lidarPoints, lidarFullFilename);
-
-        // remove Lidar points based on distance properties
-        float minZ = -1.5, maxZ = -0.9, minX = 2.0, maxX = 20.0, maxY = 2.0, minR = 0.1; // focus on ego lane
-        cropLidarPoints(lidarPoints, minX, maxX, maxY, minZ, maxZ, minR);
-    
-        (dataBuffer.end() - 1)->lidarPoints = lidarPoints;
-
-        cout << "#3 : CROP LIDAR POINTS done" << endl;
-
-
-        /* CLUSTER LIDAR POINT CLOUD */
-
-        // associate Lidar points with camera-based ROI
-        float shrinkFactor = 0.10; // shrinks each bounding box by the given percentage to avoid 3D object merging at the edges of an ROI
-        clusterLidarWithROI((dataBuffer.end()-1)->boundingBoxes, (dataBuffer.end() - 1)->lidarPoints, shrinkFactor, P_rect_00, R_rect_00, RT);
-
-        // Visualize 3D objects
-        bVis = true;
-        if(bVis)
+        scheduler.start();
+    }
+    for (size_t imgIndex = 0; bStream || imgIndex <= imgEndIndex - imgStartIndex; imgIndex+=imgStepWidth)
+    {
+        // real-time mode : wait for the frame or skip to the newest one if the pipeline has fallen behind the sensor
+        if (bRealTime)
         {
-            show3DObjects((dataBuffer.end()-1)->boundingBoxes, cv::Size(4.0, 20.0), cv::Size(2000, 2000), true);
+            size_t nDropped = scheduler.droppedFrames();
+            imgIndex = scheduler.waitForFrame(imgIndex, imgStepWidth, imgEndIndex - imgStartIndex);
+            qualityLevel = scheduler.getQualityLevel();
+            if (scheduler.droppedFrames() > nDropped)
+            {
+                cout << "#0 : REAL-TIME dropped " << scheduler.droppedFrames() - nDropped << " frame(s)" << endl;
+            }
         }
-        bVis = false;
 
-        cout << "#4 : CLUSTER LIDAR POINT CLOUD done" << endl;
-        
-        
-        // REMOVE THIS LINE BEFORE PROCEEDING WITH THE FINAL PROJECT
-        continue; // skips directly to the next image without processing what comes beneath
+        // frames which recycle a slot of the full buffer count as steady state
+        bool bSteadyFrame = dataBuffer.size() == (size_t)dataBufferSize;
+        allocCountFrameStart = getAllocationCount();
 
-        /* DETECT IMAGE KEYPOINTS */
-
-        // convert current image to grayscale
-        cv::Mat imgGray;
-        cv::cvtColor((dataBuffer.end()-1)->cameraImg, imgGray, cv::COLOR_BGR2GRAY);
+        /* LOAD IMAGE INTO BUFFER */
 
-        // extract 2D keypoints from current image
-        vector<cv::KeyPoint> keypoints; // create empty feature list for current image
-        string detectorType = "SHITOMASI";
+        // assemble filenames for current index
+        snprintf(imgNumber, sizeof(imgNumber), "%0*d", imgFillWidth, imgStartIndex + (int)imgIndex);
+        imgFullFilename.assign(imgBasePath).append(imgPrefix).append(imgNumber).append(imgFileType);
 
-        if (detectorType.compare("SHITOMASI") == 0)
+        // recycle oldest frame slot and load image from file into it
+        DataFrame &frame = dataBuffer.acquire();
+        if (bStream)
         {
-            detKeypointsShiTomasi(keypoints, imgGray, false);
+            // the image stays in its shared-memory slot (valid while the frame is in the buffer), the Lidar scan
+            // of the same time instance is swapped into the frame slot
+            if (!sensorStream.next(frame.timestamp, frame.cameraImg, frame.lidarPoints))
+            {
+                cout << "#1 : END OF SENSOR STREAM (" << sensorStream.droppedMessages() << " unpaired messages dropped)" << endl;
+                break;
+            }
         }
         else
         {
-            //...
-        }
-
-        // optional : limit number of keypoints (helpful for debugging and learning)
-        bool bLimitKpts = false;
-        if (bLimitKpts)
-        {
-            int maxKeypoints = 50;
-
-            if (detectorType.compare("SHITOMASI") == 0)
-            { // there is no response info, so keep the first 50 as they are sorted in descending quality order
-                keypoints.erase(keypoints.begin() + maxKeypoints, keypoints.end());
+            // the image is decoded into the buffer the frame slot held before (same size for all frames)
+            frame.timestamp = (imgStartIndex + imgIndex) / sensorRate;
+            if (!loadImageFromFile(imgFileBuffer, frame.cameraImg, imgFullFilename))
+            {
+                return 1;
             }
-            cv::KeyPointsFilter::retainBest(keypoints, maxKeypoints);
-            cout << " NOTE: Keypoints have been limited!" << endl;
         }
 
-        // push keypoints and descriptor for current frame to end of data buffer
-        (dataBuffer.end() - 1)->keypoints = keypoints;
-
-        cout << "#5 : DETECT KEYPOINTS done" << endl;
-
-
-        /* EXTRACT KEYPOINT DESCRIPTORS */
-
-        cv::Mat descriptors;
-        string descriptorType = "BRISK"; // BRISK, BRIEF, ORB, FREAK, AKAZE, SIFT
-        descKeypoints((dataBuffer.end() - 1)->keypoints, (dataBuffer.end() - 1)->cameraImg, descriptors, descriptorType);
-
-        // push descriptors for current frame to end of data buffer
-        (dataBuffer.end() - 1)->descriptors = descriptors;
+        cout << "#1 : LOAD IMAGE INTO BUFFER done" << endl;
 
-        cout << "#6 : EXTRACT DESCRIPTORS done" << endl;
 
+        // load 3D Lidar points from file directly into the frame slot (streamed scans are already there)
+        if (!bStream)
+        {
+            lidarFullFilename.assign(imgBasePath).append(lidarPrefix).append(imgNumber).append(lidarFileType);
+            if (!loadLidarFromFile(frame.lidarPoints, lidarFullFilename))
+            {
+                return 1;
+            }
+        }
 
-        if (dataBuffer.size() > 1) // wait until at least two images have been processed
+        // detection, Lidar clustering, keypoints, matching, TTC and track update (prints progress lines #2 to #9)
+        bool bReportFrame = config.bDownsample && bReportDownsampling;
+        if (bReportFrame)
         {
+            fullLidarPointsPrev.swap(fullLidarPointsCurr);
+            fullBoundingBoxesPrev.swap(fullBoundingBoxesCurr);
+        }
+        double frameRate = framePipeline.processFrame(dataBuffer, qualityLevel, &captures, nullptr);
 
-            /* MATCH KEYPOINT DESCRIPTORS */
+        // effect of downsampling : associate the full cloud with the same boxes
+        if (bReportFrame)
+        {
+            fullBoundingBoxesCurr = frame.boundingBoxes;
+            projectLidarPoints(fullLidarPointsCurr, fullLidarProjections, config.P_rect_xx, config.R_rect_xx, config.RT);
+            clusterLidarWithROI(fullBoundingBoxesCurr, fullLidarPointsCurr, fullLidarProjections, config.shrinkFactor);
+            if (config.bFilterClusters)
+            {
+                threadPool.parallelFor(fullBoundingBoxesCurr.size(), [&](size_t i) {
+                    keepDominantLidarCluster(fullLidarPointsCurr, fullLidarProjections, fullBoundingBoxesCurr[i].lidarPoints, config.clusterTolerance);
+                });
+            }
+        }
 
-            vector<cv::DMatch> matches;
-            string matcherType = "MAT_BF";        // MAT_BF, MAT_FLANN
-            string descriptorType = "DES_BINARY"; // DES_BINARY, DES_HOG
-            string selectorType = "SEL_NN";       // SEL_NN, SEL_KNN
+        // report results in boxID order
+        for (auto it1 = frame.ttcResults.begin(); it1 != frame.ttcResults.end(); ++it1)
+        {
+            cout << "TTC for box " << it1->boxID << " : Lidar = " << it1->ttcLidar << " s, Camera = " << it1->ttcCamera << " s" << endl;
 
-            matchDescriptors((dataBuffer.end() - 2)->keypoints, (dataBuffer.end() - 1)->keypoints,
-                             (dataBuffer.end() - 2)->descriptors, (dataBuffer.end() - 1)->descriptors,
-                             matches, descriptorType, matcherType, selectorType);
+            const Track *track = trackManager.findTrackByBox(it1->boxID);
+            if (track != nullptr)
+            {
+                cout << "    track " << track->trackID << " : smoothed TTC Lidar = " << track->ttcLidar << " s, Camera = " << track->ttcCamera << " s" << endl;
+            }
 
-            // store matches in current data frame
-            (dataBuffer.end() - 1)->kptMatches = matches;
+            // effect of downsampling : same estimator on the full clouds
+            if (bReportFrame)
+            {
+                double ttcLidarFull;
+                computeTTCLidar(fullLidarPointsPrev, fullBoundingBoxesPrev[it1->prevBoxID].lidarPoints,
+                                fullLidarPointsCurr, fullBoundingBoxesCurr[it1->boxID].lidarPoints, frameRate, ttcLidarFull);
+                cout << "    Lidar TTC on full cloud = " << ttcLidarFull << " s (difference " << it1->ttcLidar - ttcLidarFull << " s)" << endl;
+            }
+        }
 
-            cout << "#7 : MATCH KEYPOINT DESCRIPTORS done" << endl;
 
-            
-            /* TRACK 3D OBJECT BOUNDING BOXES */
+        /* RECORD INTERMEDIATE RESULTS */
 
-            //// STUDENT ASSIGNMENT
-            //// TASK FP.1 -> match list of 3D objects (vector<BoundingBox>) between current and previous frame (implement ->matchBoundingBoxes)
-            map<int, int> bbBestMatches;
-            matchBoundingBoxes(matches, bbBestMatches, *(dataBuffer.end()-2), *(dataBuffer.end()-1)); // associate bounding boxes between current and previous frame using keypoint matches
-            //// EOF STUDENT ASSIGNMENT
+        if (bRecord)
+        {
+            if (imgIndex == 0)
+            {
+                bRecord = recorder.open(recordingFile, P_rect_00, R_rect_00, RT, config.shrinkFactor, config.clusterTolerance, config.bFilterClusters);
+            }
+            recorder.writeFrame(imgStartIndex + imgIndex, frameRate, frame, recordedLidarPoints, recordedKptMatches);
+        }
 
-            // store matches in current data frame
-            (dataBuffer.end()-1)->bbMatches = bbBestMatches;
 
-            cout << "#8 : TRACK 3D OBJECT BOUNDING BOXES done" << endl;
+        /* VISUALIZE RESULTS */
 
+        // copy the results into a free renderer slot; the frame is dropped without copying when the renderer falls behind
+        if (renderer)
+        {
+            RenderSnapshot *snapshot = renderer->tryAcquireSlot();
+            if (snapshot != nullptr)
+            {
+                snapshot->frameIndex = imgStartIndex + imgIndex;
+                // copied, as the buffer of the frame slot (or the shared-memory slot) is overwritten by a later frame
+                frame.cameraImg.copyTo(snapshot->cameraImg);
+                snapshot->boundingBoxes = frame.boundingBoxes; // vector assignment keeps the capacity of the slot
+                snapshot->lidarPoints = frame.lidarPoints;
+                snapshot->lidarProjections = frame.lidarProjections;
+                snapshot->ttcResults = frame.ttcResults;
+                renderer->submit(snapshot);
+            }
+            else
+            {
+                cout << "#10 : VISUALIZE RESULTS skipped (renderer busy)" << endl;
+            }
 
-            /* COMPUTE TTC ON OBJECT IN FRONT */
+            // windows are handled on this thread, the renderer only composes the images
+            renderer->showLatest();
+        }
 
-            // loop over all BB match pairs
-            for (auto it1 = (dataBuffer.end() - 1)->bbMatches.begin(); it1 != (dataBuffer.end() - 1)->bbMatches.end(); ++it1)
-            {
-                // find bounding boxes associates with current match
-                BoundingBox *prevBB, *currBB;
-                for (auto it2 = (dataBuffer.end() - 1)->boundingBoxes.begin(); it2 != (dataBuffer.end() - 1)->boundingBoxes.end(); ++it2)
-                {
-                    if (it1->second == it2->boxID) // check wether current match partner corresponds to this BB
-                    {
-                        currBB = &(*it2);
-                    }
-                }
-
-                for (auto it2 = (dataBuffer.end() - 2)->boundingBoxes.begin(); it2 != (dataBuffer.end() - 2)->boundingBoxes.end(); ++it2)
-                {
-                    if (it1->first == it2->boxID) // check wether current match partner corresponds to this BB
-                    {
-                        prevBB = &(*it2);
-                    }
-                }
-
-                // compute TTC for current match
-                if( currBB->lidarPoints.size()>0 && prevBB->lidarPoints.size()>0 ) // only compute TTC if we have Lidar points
-                {
-                    //// STUDENT ASSIGNMENT
-                    //// TASK FP.2 -> compute time-to-collision based on Lidar data (implement -> computeTTCLidar)
-                    double ttcLidar; 
-                    computeTTCLidar(prevBB->lidarPoints, currBB->lidarPoints, sensorFrameRate, ttcLidar);
-                    //// EOF STUDENT ASSIGNMENT
-
-                    //// STUDENT ASSIGNMENT
-                    //// TASK FP.3 -> assign enclosed keypoint matches to bounding box (implement -> clusterKptMatchesWithROI)
-                    //// TASK FP.4 -> compute time-to-collision based on camera (implement -> computeTTCCamera)
-                    double ttcCamera;
-                    clusterKptMatchesWithROI(*currBB, (dataBuffer.end() - 2)->keypoints, (dataBuffer.end() - 1)->keypoints, (dataBuffer.end() - 1)->kptMatches);                    
-                    computeTTCCamera((dataBuffer.end() - 2)->keypoints, (dataBuffer.end() - 1)->keypoints, currBB->kptMatches, sensorFrameRate, ttcCamera);
-                    //// EOF STUDENT ASSIGNMENT
-
-                    bVis = true;
-                    if (bVis)
-                    {
-                        cv::Mat visImg = (dataBuffer.end() - 1)->cameraImg.clone();
-                        showLidarImgOverlay(visImg, currBB->lidarPoints, P_rect_00, R_rect_00, RT, &visImg);
-                        cv::rectangle(visImg, cv::Point(currBB->roi.x, currBB->roi.y), cv::Point(currBB->roi.x + currBB->roi.width, currBB->roi.y + currBB->roi.height), cv::Scalar(0, 255, 0), 2);
-                        
-                        char str[200];
-                        sprintf(str, "TTC Lidar : %f s, TTC Camera : %f s", ttcLidar, ttcCamera);
-                        putText(visImg, str, cv::Point2f(80, 50), cv::FONT_HERSHEY_PLAIN, 2, cv::Scalar(0,0,255));
-
-                        string windowName = "Final Results : TTC";
-                        cv::namedWindow(windowName, 4);
-                        cv::imshow(windowName, visImg);
-                        cout << "Press key to continue to next frame" << endl;
-                        cv::waitKey(0);
-                    }
-                    bVis = false;
-
-                } // eof TTC computation
-            } // eof loop over all BB matches            
+        if (bRealTime)
+        {
+            double latency = scheduler.frameDone();
+            cout << "#11 : REAL-TIME latency " << 1000 * latency << " ms (deadline " << 1000 * realTimeConfig.deadline
+                 << " ms, quality level " << (int)qualityLevel << ")" << endl;
+        }
 
+        if (bSteadyFrame)
+        {
+            size_t nAllocs = getAllocationCount() - allocCountFrameStart;
+            steadyAllocMin = nSteadyFrames == 0 || nAllocs < steadyAllocMin ? nAllocs : steadyAllocMin;
+            steadyAllocMax = nAllocs > steadyAllocMax ? nAllocs : steadyAllocMax;
+            steadyAllocSum += nAllocs;
+            ++nSteadyFrames;
         }
 
     } // eof loop over all images
 
+    // heap allocations per steady-state frame (all threads, including cv::Mat buffers and other allocations inside OpenCV)
+    if (nSteadyFrames > 0)
+    {
+        cout << "HEAP ALLOCATIONS per steady-state frame : min = " << steadyAllocMin << ", max = " << steadyAllocMax
+             << ", mean = " << (double)steadyAllocSum / nSteadyFrames << " (" << nSteadyFrames << " frames)" << endl;
+    }
+
     return 0;
 }
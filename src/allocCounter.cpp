@@ -0,0 +1,65 @@
+#include <atomic>
+#include <cerrno>
+#include <cstdlib>
+
+#include "allocCounter.hpp"
+
+// replaces the C allocation functions of glibc so that every heap allocation made by this program is counted : the
+// default operator new, cv::fastMalloc (cv::Mat buffers, DNN blobs) and other libraries all end up in one of them
+static std::atomic<size_t> allocationCount(0);
+
+size_t getAllocationCount()
+{
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+// allocation functions of glibc, which remain reachable under these names when malloc and co. are replaced
+extern "C" void *__libc_malloc(size_t size);
+extern "C" void *__libc_calloc(size_t n, size_t size);
+extern "C" void *__libc_realloc(void *ptr, size_t size);
+extern "C" void *__libc_memalign(size_t alignment, size_t size);
+
+extern "C" void *malloc(size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_malloc(size);
+}
+
+extern "C" void *calloc(size_t n, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_calloc(n, size);
+}
+
+extern "C" void *realloc(void *ptr, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_realloc(ptr, size);
+}
+
+extern "C" void *memalign(size_t alignment, size_t size)
+{
+    allocationCount.fetch_add(1, std::memory_order_relaxed);
+    return __libc_memalign(alignment, size);
+}
+
+extern "C" void *aligned_alloc(size_t alignment, size_t size)
+{
+    return memalign(alignment, size);
+}
+
+extern "C" int posix_memalign(void **ptr, size_t alignment, size_t size)
+{
+    // alignment must be a power of two multiple of sizeof(void *)
+    if (alignment % sizeof(void *) != 0 || (alignment & (alignment - 1)) != 0)
+    {
+        return EINVAL;
+    }
+    void *mem = memalign(alignment, size);
+    if (mem == nullptr)
+    {
+        return ENOMEM;
+    }
+    *ptr = mem;
+    return 0;
+}
@@ -0,0 +1,11 @@
+
+#ifndef allocCounter_hpp
+#define allocCounter_hpp
+
+#include <stddef.h>
+
+// no. of heap allocations made through malloc and its variants since program start (all threads, including operator new
+// and the buffers of cv::Mat)
+size_t getAllocationCount();
+
+#endif /* allocCounter_hpp */
@@ -0,0 +1,228 @@
+/* PROCESS SEVERAL RECORDED DRIVES CONCURRENTLY AND COLLECT TTC AND TIMING RESULTS */
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cmath>
+#include <cstdlib>
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "objectDetection2D.hpp"
+#include "kittiCalibration.hpp"
+#include "sequenceProcessor.hpp"
+#include "threadPool.hpp"
+
+using namespace std;
+
+// manifest : one sequence per line, "name driveDir calibDir firstIndex lastIndex", directories relative to the data
+// path; empty lines and lines starting with '#' are ignored. Like the main program, images are read from the left color
+// camera (image_02) and projected with the rectified calibration of the reference camera (P_rect_00)
+static bool readManifest(const string &manifestFile, const string &dataPath, vector<SequenceConfig> &sequences)
+{
+    ifstream ifs(manifestFile.c_str());
+    if (!ifs)
+    {
+        cerr << "Unable to open manifest " << manifestFile << endl;
+        return false;
+    }
+
+    string line;
+    int lineNumber = 0;
+    while (getline(ifs, line))
+    {
+        ++lineNumber;
+        istringstream fields(line);
+        string name, driveDir, calibDir;
+        int firstIndex, lastIndex;
+        if (!(fields >> name) || name[0] == '#')
+        {
+            continue;
+        }
+        if (!(fields >> driveDir >> calibDir >> firstIndex >> lastIndex))
+        {
+            cerr << manifestFile << ":" << lineNumber << " : expected name, driveDir, calibDir, firstIndex, lastIndex" << endl;
+            return false;
+        }
+
+        SequenceConfig config;
+        config.name = name;
+        config.imgPrefix = dataPath + driveDir + "/image_02/data/"; // left camera, color
+        config.imgFileType = ".png";
+        config.lidarPrefix = dataPath + driveDir + "/velodyne_points/data/";
+        config.lidarFileType = ".bin";
+        config.imgStartIndex = firstIndex;
+        config.imgEndIndex = lastIndex;
+        config.imgStepWidth = 1;
+        config.imgFillWidth = 10;
+        config.sensorRate = 10.0;
+        if (!loadKittiCalibration(dataPath + calibDir + "/calib_cam_to_cam.txt", dataPath + calibDir + "/calib_velo_to_cam.txt",
+                                  "00", config.P_rect_xx, config.R_rect_xx, config.RT))
+        {
+            return false;
+        }
+        sequences.push_back(config);
+    }
+    return true;
+}
+
+// sum and no. of finite values
+static void accumulateFinite(double value, double &sum, int &count)
+{
+    if (std::isfinite(value))
+    {
+        sum += value;
+        ++count;
+    }
+}
+
+static void writeTimes(ofstream &ofs, const StageTimes &times, int nFrames)
+{
+    ofs << "," << times.detection << "," << times.lidar << "," << times.keypoints << "," << times.matching << "," << times.ttc
+        << "," << times.total << "," << (times.total > 0.0 ? nFrames / times.total : 0.0);
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 3)
+    {
+        cout << "usage : " << argv[0] << " <manifest> <output file> [workers] [data path]" << endl;
+        cout << "workers : no. of sequences processed at the same time (0 = no. of hardware cores)" << endl;
+        return 1;
+    }
+    string manifestFile = argv[1];
+    string outputFile = argv[2];
+    size_t nWorkers = argc > 3 ? atoi(argv[3]) : 0;
+    string dataPath = argc > 4 ? argv[4] : "../images/";
+
+    // object detection model, read once to build one detector per worker (see below)
+    string yoloBasePath = "../dat/yolo/";
+    YoloModelData yoloModel;
+    if (!loadYoloModelData(yoloBasePath + "coco.names", yoloBasePath + "yolov3.cfg", yoloBasePath + "yolov3.weights", yoloModel))
+    {
+        return 1;
+    }
+
+    vector<SequenceConfig> sequences;
+    if (!readManifest(manifestFile, dataPath, sequences))
+    {
+        return 1;
+    }
+
+    // sequences are the unit of parallelism, so OpenCV and the tasks within a frame run single-threaded within each
+    // worker; a single worker distributes the tasks within a frame over all cores instead
+    ThreadPool workers(nWorkers);
+    size_t nFrameThreads = 0;
+    if (workers.size() > 1)
+    {
+        cv::setNumThreads(1);
+        nFrameThreads = 1;
+    }
+
+    // parsing the network is expensive, so each worker gets one detector which it re-uses for all its sequences; no
+    // more tasks than threads run at a time, so a task always finds an unused detector. The model bytes are not needed
+    // once all detectors are built
+    vector<unique_ptr<ObjectDetector>> detectors;
+    for (size_t i = 0; i < min(workers.size(), sequences.size()); ++i)
+    {
+        detectors.emplace_back(new ObjectDetector(yoloModel));
+    }
+    yoloModel = YoloModelData();
+    vector<ObjectDetector *> freeDetectors;
+    for (auto it = detectors.begin(); it != detectors.end(); ++it)
+    {
+        freeDetectors.push_back(it->get());
+    }
+    mutex detectorMtx;
+
+    // each task only writes the result slot of its own sequence
+    vector<SequenceResult> results(sequences.size());
+    double tBatch = (double)cv::getTickCount();
+    workers.parallelFor(sequences.size(), [&](size_t i) {
+        ObjectDetector *detector;
+        {
+            lock_guard<mutex> lock(detectorMtx);
+            detector = freeDetectors.back();
+            freeDetectors.pop_back();
+        }
+        processSequence(sequences[i], *detector, nFrameThreads, results[i]);
+        {
+            lock_guard<mutex> lock(detectorMtx);
+            freeDetectors.push_back(detector);
+        }
+        cout << sequences[i].name << " : " << (results[i].bOk ? "done" : "failed") << " (" << results[i].nFrames << " frames)" << endl;
+    });
+    tBatch = ((double)cv::getTickCount() - tBatch) / cv::getTickFrequency();
+
+    /* WRITE RESULTS */
+
+    ofstream ofs(outputFile.c_str());
+    if (!ofs)
+    {
+        cerr << "Unable to write results to " << outputFile << endl;
+        return 1;
+    }
+
+    ofs << "# TTC per frame and matched bounding box [s]" << endl;
+    ofs << "sequence,frame,boxID,prevBoxID,trackID,ttcLidar,ttcCamera" << endl;
+    for (auto it1 = results.begin(); it1 != results.end(); ++it1)
+    {
+        for (auto it2 = it1->ttcResults.begin(); it2 != it1->ttcResults.end(); ++it2)
+        {
+            ofs << it1->name << "," << it2->frameIndex << "," << it2->ttc.boxID << "," << it2->ttc.prevBoxID << "," << it2->trackID
+                << "," << it2->ttc.ttcLidar << "," << it2->ttc.ttcCamera << endl;
+        }
+    }
+
+    ofs << endl << "# per sequence : TTC statistics and processing time per stage [s]" << endl;
+    ofs << "sequence,status,frames,nTTCLidar,meanTTCLidar,nTTCCamera,meanTTCCamera,meanAbsDifference,"
+        << "detection,lidar,keypoints,matching,ttc,total,framesPerSecond" << endl;
+    StageTimes totalTimes;
+    int nTotalFrames = 0, nFailed = 0;
+    double sumLidarAll = 0.0, sumCameraAll = 0.0, sumDiffAll = 0.0;
+    int nLidarAll = 0, nCameraAll = 0, nDiffAll = 0;
+    for (auto it1 = results.begin(); it1 != results.end(); ++it1)
+    {
+        double sumLidar = 0.0, sumCamera = 0.0, sumDiff = 0.0;
+        int nLidar = 0, nCamera = 0, nDiff = 0;
+        for (auto it2 = it1->ttcResults.begin(); it2 != it1->ttcResults.end(); ++it2)
+        {
+            accumulateFinite(it2->ttc.ttcLidar, sumLidar, nLidar);
+            accumulateFinite(it2->ttc.ttcCamera, sumCamera, nCamera);
+            accumulateFinite(fabs(it2->ttc.ttcLidar - it2->ttc.ttcCamera), sumDiff, nDiff);
+        }
+
+        ofs << it1->name << "," << (it1->bOk ? "ok" : "failed") << "," << it1->nFrames << "," << nLidar << "," << (nLidar > 0 ? sumLidar / nLidar : NAN)
+            << "," << nCamera << "," << (nCamera > 0 ? sumCamera / nCamera : NAN) << "," << (nDiff > 0 ? sumDiff / nDiff : NAN);
+        writeTimes(ofs, it1->times, it1->nFrames);
+        ofs << endl;
+
+        // aggregate over all sequences
+        totalTimes.detection += it1->times.detection;
+        totalTimes.lidar += it1->times.lidar;
+        totalTimes.keypoints += it1->times.keypoints;
+        totalTimes.matching += it1->times.matching;
+        totalTimes.ttc += it1->times.ttc;
+        totalTimes.total += it1->times.total;
+        nTotalFrames += it1->nFrames;
+        nFailed += it1->bOk ? 0 : 1;
+        sumLidarAll += sumLidar; nLidarAll += nLidar;
+        sumCameraAll += sumCamera; nCameraAll += nCamera;
+        sumDiffAll += sumDiff; nDiffAll += nDiff;
+    }
+
+    ofs << endl << "# aggregate : per-stage times are summed over all workers, wallTime is the elapsed time of the batch" << endl;
+    ofs << "sequences,failed,frames,nTTCLidar,meanTTCLidar,nTTCCamera,meanTTCCamera,meanAbsDifference,"
+        << "detection,lidar,keypoints,matching,ttc,total,framesPerSecond,workers,wallTime,framesPerSecondWall" << endl;
+    ofs << results.size() << "," << nFailed << "," << nTotalFrames << "," << nLidarAll << "," << (nLidarAll > 0 ? sumLidarAll / nLidarAll : NAN)
+        << "," << nCameraAll << "," << (nCameraAll > 0 ? sumCameraAll / nCameraAll : NAN) << "," << (nDiffAll > 0 ? sumDiffAll / nDiffAll : NAN);
+    writeTimes(ofs, totalTimes, nTotalFrames);
+    ofs << "," << workers.size() << "," << tBatch << "," << (tBatch > 0.0 ? nTotalFrames / tBatch : 0.0) << endl;
+
+    cout << "results of " << results.size() << " sequences (" << nFailed << " failed) written to " << outputFile << endl;
+    return nFailed > 0 ? 2 : 0;
+}
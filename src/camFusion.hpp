@@ -8,14 +8,16 @@
 #include "dataStructures.h"
 
 
-void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, std::vector<LidarPoint> &lidarPoints, float shrinkFactor, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT);
-void clusterKptMatchesWithROI(BoundingBox &boundingBox, std::vector<cv::KeyPoint> &kptsPrev, std::vector<cv::KeyPoint> &kptsCurr, std::vector<cv::DMatch> &kptMatches);
-void matchBoundingBoxes(std::vector<cv::DMatch> &matches, std::map<int, int> &bbBestMatches, DataFrame &prevFrame, DataFrame &currFrame);
+void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, std::vector<LidarPoint> &lidarPoints, std::vector<cv::Point3f> &lidarProjections, float shrinkFactor);
+void keepDominantLidarCluster(std::vector<LidarPoint> &lidarPoints, std::vector<cv::Point3f> &lidarProjections, IndexSpan &span, float clusterTolerance);
+void clusterKptMatchesWithROI(std::vector<BoundingBox> &boundingBoxes, const std::vector<cv::KeyPoint> &kptsPrev, const std::vector<cv::KeyPoint> &kptsCurr, std::vector<cv::DMatch> &kptMatches);
+void matchBoundingBoxes(const std::vector<cv::DMatch> &matches, std::vector<std::pair<int, int>> &bbBestMatches, const DataFrame &prevFrame, const DataFrame &currFrame);
 
-void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize, cv::Size imageSize, bool bWait=true);
+void show3DObjects(const std::vector<BoundingBox> &boundingBoxes, const std::vector<LidarPoint> &lidarPoints, cv::Size worldSize, cv::Size imageSize, bool bWait=true);
+cv::Mat render3DObjects(const std::vector<BoundingBox> &boundingBoxes, const std::vector<LidarPoint> &lidarPoints, cv::Size worldSize, cv::Size imageSize);
 
-void computeTTCCamera(std::vector<cv::KeyPoint> &kptsPrev, std::vector<cv::KeyPoint> &kptsCurr,
-                      std::vector<cv::DMatch> kptMatches, double frameRate, double &TTC, cv::Mat *visImg=nullptr);
-void computeTTCLidar(std::vector<LidarPoint> &lidarPointsPrev,
-                     std::vector<LidarPoint> &lidarPointsCurr, double frameRate, double &TTC);                  
+void computeTTCCamera(const std::vector<cv::KeyPoint> &kptsPrev, const std::vector<cv::KeyPoint> &kptsCurr,
+                      const std::vector<cv::DMatch> &kptMatches, IndexSpan matchSpan, double frameRate, double &TTC, cv::Mat *visImg=nullptr);
+void computeTTCLidar(const std::vector<LidarPoint> &lidarPointsPrev, IndexSpan spanPrev,
+                     const std::vector<LidarPoint> &lidarPointsCurr, IndexSpan spanCurr, double frameRate, double &TTC);
 #endif /* camFusion_hpp */
@@ -2,6 +2,9 @@
 #include <iostream>
 #include <algorithm>
 #include <numeric>
+#include <limits>
+#include <cmath>
+#include <cstdint>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 
@@ -11,57 +14,212 @@
 using namespace std;
 
 
-// Create groups of Lidar points whose projection into the camera falls into the same bounding box
-void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, std::vector<LidarPoint> &lidarPoints, float shrinkFactor, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT)
+// Create groups of Lidar points whose projection into the camera falls into the same bounding box;
+// the points and their cached projections are reordered so that each box refers to a contiguous range of the
+// frame-owned point cloud
+void clusterLidarWithROI(std::vector<BoundingBox> &boundingBoxes, std::vector<LidarPoint> &lidarPoints, std::vector<cv::Point3f> &lidarProjections, float shrinkFactor)
 {
-    // loop over all Lidar points and associate them to a 2D bounding box
-    cv::Mat X(4, 1, cv::DataType<double>::type);
-    cv::Mat Y(3, 1, cv::DataType<double>::type);
+    // scratch buffers keep their capacity across frames
+    static thread_local vector<int> pointOwner; // index of the single enclosing box for each point, -1 if none or ambiguous
+    static thread_local vector<int> boxOffsets; // start of each box range in the reordered point cloud
+    static thread_local vector<LidarPoint> sortedPoints;
+    static thread_local vector<cv::Point3f> sortedProjections;
+    pointOwner.assign(lidarPoints.size(), -1);
+    boxOffsets.assign(boundingBoxes.size() + 1, 0);
 
-    for (auto it1 = lidarPoints.begin(); it1 != lidarPoints.end(); ++it1)
+    // loop over all Lidar points and associate them to a 2D bounding box
+    for (size_t i = 0; i < lidarPoints.size(); ++i)
     {
-        // assemble vector for matrix-vector-multiplication
-        X.at<double>(0, 0) = it1->x;
-        X.at<double>(1, 0) = it1->y;
-        X.at<double>(2, 0) = it1->z;
-        X.at<double>(3, 0) = 1;
-
-        // project Lidar point into camera
-        Y = P_rect_xx * R_rect_xx * RT * X;
+        // pixel coordinates of the projected Lidar point
         cv::Point pt;
-        pt.x = Y.at<double>(0, 0) / Y.at<double>(0, 2); // pixel coordinates
-        pt.y = Y.at<double>(1, 0) / Y.at<double>(0, 2);
+        pt.x = lidarProjections[i].x;
+        pt.y = lidarProjections[i].y;
 
-        vector<vector<BoundingBox>::iterator> enclosingBoxes; // pointers to all bounding boxes which enclose the current Lidar point
-        for (vector<BoundingBox>::iterator it2 = boundingBoxes.begin(); it2 != boundingBoxes.end(); ++it2)
+        int nEnclosing = 0; // no. of bounding boxes which enclose the current Lidar point
+        for (size_t j = 0; j < boundingBoxes.size(); ++j)
         {
             // shrink current bounding box slightly to avoid having too many outlier points around the edges
+            const cv::Rect &roi = boundingBoxes[j].roi;
             cv::Rect smallerBox;
-            smallerBox.x = (*it2).roi.x + shrinkFactor * (*it2).roi.width / 2.0;
-            smallerBox.y = (*it2).roi.y + shrinkFactor * (*it2).roi.height / 2.0;
-            smallerBox.width = (*it2).roi.width * (1 - shrinkFactor);
-            smallerBox.height = (*it2).roi.height * (1 - shrinkFactor);
+            smallerBox.x = roi.x + shrinkFactor * roi.width / 2.0;
+            smallerBox.y = roi.y + shrinkFactor * roi.height / 2.0;
+            smallerBox.width = roi.width * (1 - shrinkFactor);
+            smallerBox.height = roi.height * (1 - shrinkFactor);
 
             // check wether point is within current bounding box
             if (smallerBox.contains(pt))
             {
-                enclosingBoxes.push_back(it2);
+                pointOwner[i] = (int)j;
+                ++nEnclosing;
             }
 
         } // eof loop over all bounding boxes
 
-        // check wether point has been enclosed by one or by multiple boxes
-        if (enclosingBoxes.size() == 1)
-        { 
-            // add Lidar point to bounding box
-            enclosingBoxes[0]->lidarPoints.push_back(*it1);
+        // only points enclosed by exactly one box are assigned to it
+        if (nEnclosing == 1)
+        {
+            ++boxOffsets[pointOwner[i] + 1];
+        }
+        else
+        {
+            pointOwner[i] = -1;
         }
 
     } // eof loop over all Lidar points
+
+    // turn per-box counts into range offsets and set the box spans
+    for (size_t j = 0; j < boundingBoxes.size(); ++j)
+    {
+        boundingBoxes[j].lidarPoints.begin = boxOffsets[j];
+        boundingBoxes[j].lidarPoints.size = boxOffsets[j + 1];
+        boxOffsets[j + 1] += boxOffsets[j];
+    }
+
+    // stable counting sort : points of box 0, box 1, ... followed by all unassigned points
+    sortedPoints.resize(lidarPoints.size());
+    sortedProjections.resize(lidarProjections.size());
+    int nextUnassigned = boxOffsets[boundingBoxes.size()];
+    for (size_t i = 0; i < lidarPoints.size(); ++i)
+    {
+        int dst = pointOwner[i] >= 0 ? boxOffsets[pointOwner[i]]++ : nextUnassigned++;
+        sortedPoints[dst] = lidarPoints[i];
+        sortedProjections[dst] = lidarProjections[i];
+    }
+    lidarPoints.swap(sortedPoints);
+    lidarProjections.swap(sortedProjections);
+}
+
+
+// key of the cubic grid cell of size cellSize which contains a point (21 bits per axis)
+static uint64_t gridCellKey(int64_t ix, int64_t iy, int64_t iz)
+{
+    return ((uint64_t)((ix + (1 << 20)) & 0x1FFFFF) << 42) | ((uint64_t)((iy + (1 << 20)) & 0x1FFFFF) << 21) | (uint64_t)((iz + (1 << 20)) & 0x1FFFFF);
+}
+
+// Euclidean clustering of the Lidar points of one bounding box : points closer than clusterTolerance are connected;
+// only the largest cluster is kept at the front of the span, all other points (and their cached projections) are moved
+// behind it and the span is shrunk.
+// Neighbors are found through a grid with cell size clusterTolerance, sorted by cell key, so that each point only
+// has to be compared with the points of its 27 neighboring cells.
+void keepDominantLidarCluster(std::vector<LidarPoint> &lidarPoints, std::vector<cv::Point3f> &lidarProjections, IndexSpan &span, float clusterTolerance)
+{
+    if (span.size < 2 || clusterTolerance <= 0.0)
+    {
+        return;
+    }
+
+    // scratch buffers keep their capacity across frames, one set per thread
+    static thread_local vector<pair<uint64_t, int>> cells; // (cell key, point index within span), sorted by key
+    static thread_local vector<int> labels;
+    static thread_local vector<int> clusterSizes;
+    static thread_local vector<int> bfsQueue;
+    static thread_local vector<LidarPoint> sortedPoints;
+    static thread_local vector<cv::Point3f> sortedProjections;
+
+    LidarPoint *pts = &lidarPoints[span.begin];
+    cv::Point3f *projs = &lidarProjections[span.begin];
+    double invCellSize = 1.0 / clusterTolerance;
+    double maxDistSq = (double)clusterTolerance * clusterTolerance;
+
+    cells.resize(span.size);
+    for (int i = 0; i < span.size; ++i)
+    {
+        cells[i] = make_pair(gridCellKey((int64_t)floor(pts[i].x * invCellSize), (int64_t)floor(pts[i].y * invCellSize),
+                                         (int64_t)floor(pts[i].z * invCellSize)), i);
+    }
+    sort(cells.begin(), cells.end());
+
+    // breadth-first search over connected points
+    labels.assign(span.size, -1);
+    clusterSizes.clear();
+    for (int seed = 0; seed < span.size; ++seed)
+    {
+        if (labels[seed] >= 0)
+        {
+            continue;
+        }
+
+        int label = (int)clusterSizes.size();
+        clusterSizes.push_back(0);
+        labels[seed] = label;
+        bfsQueue.assign(1, seed);
+        for (size_t head = 0; head < bfsQueue.size(); ++head)
+        {
+            const LidarPoint &p = pts[bfsQueue[head]];
+            ++clusterSizes[label];
+
+            int64_t cx = (int64_t)floor(p.x * invCellSize), cy = (int64_t)floor(p.y * invCellSize), cz = (int64_t)floor(p.z * invCellSize);
+            for (int64_t dx = -1; dx <= 1; ++dx)
+            for (int64_t dy = -1; dy <= 1; ++dy)
+            for (int64_t dz = -1; dz <= 1; ++dz)
+            {
+                uint64_t key = gridCellKey(cx + dx, cy + dy, cz + dz);
+                auto itCell = lower_bound(cells.begin(), cells.end(), make_pair(key, -1));
+                for (; itCell != cells.end() && itCell->first == key; ++itCell)
+                {
+                    int j = itCell->second;
+                    if (labels[j] >= 0)
+                    {
+                        continue;
+                    }
+
+                    double ddx = pts[j].x - p.x, ddy = pts[j].y - p.y, ddz = pts[j].z - p.z;
+                    if (ddx * ddx + ddy * ddy + ddz * ddz <= maxDistSq)
+                    {
+                        labels[j] = label;
+                        bfsQueue.push_back(j);
+                    }
+                }
+            }
+        }
+    }
+
+    // largest cluster wins, ties go to the cluster found first
+    int dominant = (int)(max_element(clusterSizes.begin(), clusterSizes.end()) - clusterSizes.begin());
+
+    // stable partition : dominant cluster first, remaining points behind it
+    sortedPoints.clear();
+    sortedProjections.clear();
+    for (int i = 0; i < span.size; ++i)
+    {
+        if (labels[i] == dominant)
+        {
+            sortedPoints.push_back(pts[i]);
+            sortedProjections.push_back(projs[i]);
+        }
+    }
+    for (int i = 0; i < span.size; ++i)
+    {
+        if (labels[i] != dominant)
+        {
+            sortedPoints.push_back(pts[i]);
+            sortedProjections.push_back(projs[i]);
+        }
+    }
+    copy(sortedPoints.begin(), sortedPoints.end(), pts);
+    copy(sortedProjections.begin(), sortedProjections.end(), projs);
+    span.size = clusterSizes[dominant];
+}
+
+
+void show3DObjects(const std::vector<BoundingBox> &boundingBoxes, const std::vector<LidarPoint> &lidarPoints, cv::Size worldSize, cv::Size imageSize, bool bWait)
+{
+    cv::Mat topviewImg = render3DObjects(boundingBoxes, lidarPoints, worldSize, imageSize);
+
+    // display image
+    string windowName = "3D Objects";
+    cv::namedWindow(windowName, 1);
+    cv::imshow(windowName, topviewImg);
+
+    if(bWait)
+    {
+        cv::waitKey(0); // wait for key to be pressed
+    }
 }
 
 
-void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize, cv::Size imageSize, bool bWait)
+// draw a top view of the Lidar points of all 3D objects without displaying it
+cv::Mat render3DObjects(const std::vector<BoundingBox> &boundingBoxes, const std::vector<LidarPoint> &lidarPoints, cv::Size worldSize, cv::Size imageSize)
 {
     // create topview image
     cv::Mat topviewImg(imageSize, CV_8UC3, cv::Scalar(255, 255, 255));
@@ -75,7 +233,8 @@ void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize,
         // plot Lidar points into top view image
         int top=1e8, left=1e8, bottom=0.0, right=0.0; 
         float xwmin=1e8, ywmin=1e8, ywmax=-1e8;
-        for (auto it2 = it1->lidarPoints.begin(); it2 != it1->lidarPoints.end(); ++it2)
+        auto itBegin = lidarPoints.begin() + it1->lidarPoints.begin;
+        for (auto it2 = itBegin; it2 != itBegin + it1->lidarPoints.size; ++it2)
         {
             // world coordinates
             float xw = (*it2).x; // world position in m with x facing forward from sensor
@@ -103,7 +262,7 @@ void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize,
 
         // augment object with some key data
         char str1[200], str2[200];
-        sprintf(str1, "id=%d, #pts=%d", it1->boxID, (int)it1->lidarPoints.size());
+        sprintf(str1, "id=%d, #pts=%d", it1->boxID, it1->lidarPoints.size);
         putText(topviewImg, str1, cv::Point2f(left-250, bottom+50), cv::FONT_ITALIC, 2, currColor);
         sprintf(str2, "xmin=%2.2f m, yw=%2.2f m", xwmin, ywmax-ywmin);
         putText(topviewImg, str2, cv::Point2f(left-250, bottom+125), cv::FONT_ITALIC, 2, currColor);  
@@ -118,41 +277,227 @@ void show3DObjects(std::vector<BoundingBox> &boundingBoxes, cv::Size worldSize,
         cv::line(topviewImg, cv::Point(0, y), cv::Point(imageSize.width, y), cv::Scalar(255, 0, 0));
     }
 
-    // display image
-    string windowName = "3D Objects";
-    cv::namedWindow(windowName, 1);
-    cv::imshow(windowName, topviewImg);
+    return topviewImg;
+}
 
-    if(bWait)
+
+// associate keypoint matches with the bounding box enclosing the current keypoint and remove outliers;
+// the matches are reordered so that each box refers to a contiguous range of the frame-owned match list
+void clusterKptMatchesWithROI(std::vector<BoundingBox> &boundingBoxes, const std::vector<cv::KeyPoint> &kptsPrev, const std::vector<cv::KeyPoint> &kptsCurr, std::vector<cv::DMatch> &kptMatches)
+{
+    static thread_local vector<int> matchOwner; // index of the single enclosing box for each match, -1 if none or ambiguous
+    static thread_local vector<int> boxOffsets; // start of each box range in the reordered match list
+    static thread_local vector<cv::DMatch> sortedMatches;
+    matchOwner.assign(kptMatches.size(), -1);
+    boxOffsets.assign(boundingBoxes.size() + 1, 0);
+
+    for (size_t i = 0; i < kptMatches.size(); ++i)
     {
-        cv::waitKey(0); // wait for key to be pressed
+        const cv::Point2f &pt = kptsCurr[kptMatches[i].trainIdx].pt;
+
+        int nEnclosing = 0;
+        for (size_t j = 0; j < boundingBoxes.size(); ++j)
+        {
+            if (boundingBoxes[j].roi.contains(pt))
+            {
+                matchOwner[i] = (int)j;
+                ++nEnclosing;
+            }
+        }
+
+        if (nEnclosing == 1)
+        {
+            ++boxOffsets[matchOwner[i] + 1];
+        }
+        else
+        {
+            matchOwner[i] = -1;
+        }
+    }
+
+    for (size_t j = 0; j < boundingBoxes.size(); ++j)
+    {
+        boundingBoxes[j].kptMatches.begin = boxOffsets[j];
+        boundingBoxes[j].kptMatches.size = boxOffsets[j + 1];
+        boxOffsets[j + 1] += boxOffsets[j];
     }
-}
 
+    // stable counting sort : matches of box 0, box 1, ... followed by all unassigned matches
+    sortedMatches.resize(kptMatches.size());
+    int nextUnassigned = boxOffsets[boundingBoxes.size()];
+    for (size_t i = 0; i < kptMatches.size(); ++i)
+    {
+        int dst = matchOwner[i] >= 0 ? boxOffsets[matchOwner[i]]++ : nextUnassigned++;
+        sortedMatches[dst] = kptMatches[i];
+    }
+    kptMatches.swap(sortedMatches);
 
-// associate a given bounding box with the keypoints it contains
-void clusterKptMatchesWithROI(BoundingBox &boundingBox, std::vector<cv::KeyPoint> &kptsPrev, std::vector<cv::KeyPoint> &kptsCurr, std::vector<cv::DMatch> &kptMatches)
-{
-    // ...
+    // remove matches whose displacement is far above the box average by moving them behind the box range
+    const double maxDistRatio = 1.5;
+    for (auto it = boundingBoxes.begin(); it != boundingBoxes.end(); ++it)
+    {
+        if (it->kptMatches.size == 0)
+        {
+            continue;
+        }
+
+        auto itBegin = kptMatches.begin() + it->kptMatches.begin;
+        auto itEnd = itBegin + it->kptMatches.size;
+
+        double meanDist = 0.0;
+        for (auto itMatch = itBegin; itMatch != itEnd; ++itMatch)
+        {
+            meanDist += cv::norm(kptsCurr[itMatch->trainIdx].pt - kptsPrev[itMatch->queryIdx].pt);
+        }
+        meanDist /= it->kptMatches.size;
+
+        auto itInliersEnd = std::partition(itBegin, itEnd, [&](const cv::DMatch &match) {
+            return cv::norm(kptsCurr[match.trainIdx].pt - kptsPrev[match.queryIdx].pt) <= maxDistRatio * meanDist;
+        });
+        it->kptMatches.size = (int)(itInliersEnd - itBegin);
+    }
 }
 
 
 // Compute time-to-collision (TTC) based on keypoint correspondences in successive images
-void computeTTCCamera(std::vector<cv::KeyPoint> &kptsPrev, std::vector<cv::KeyPoint> &kptsCurr, 
-                      std::vector<cv::DMatch> kptMatches, double frameRate, double &TTC, cv::Mat *visImg)
+void computeTTCCamera(const std::vector<cv::KeyPoint> &kptsPrev, const std::vector<cv::KeyPoint> &kptsCurr,
+                      const std::vector<cv::DMatch> &kptMatches, IndexSpan matchSpan, double frameRate, double &TTC, cv::Mat *visImg)
 {
-    // ...
+    // compute distance ratios between all pairs of matched keypoints within the box
+    static thread_local vector<double> distRatios;
+    distRatios.clear();
+
+    double minDist = 100.0; // min. required distance in pixels to get a stable ratio
+    auto itBegin = kptMatches.begin() + matchSpan.begin;
+    auto itEnd = itBegin + matchSpan.size;
+    for (auto it1 = itBegin; it1 != itEnd; ++it1)
+    {
+        const cv::Point2f &outerCurr = kptsCurr[it1->trainIdx].pt;
+        const cv::Point2f &outerPrev = kptsPrev[it1->queryIdx].pt;
+
+        for (auto it2 = it1 + 1; it2 != itEnd; ++it2)
+        {
+            double distCurr = cv::norm(outerCurr - kptsCurr[it2->trainIdx].pt);
+            double distPrev = cv::norm(outerPrev - kptsPrev[it2->queryIdx].pt);
+
+            if (distPrev > std::numeric_limits<double>::epsilon() && distCurr >= minDist)
+            {
+                distRatios.push_back(distCurr / distPrev);
+            }
+        }
+    }
+
+    if (distRatios.empty())
+    {
+        TTC = NAN;
+        return;
+    }
+
+    // median distance ratio is robust against remaining mismatches
+    auto itMedian = distRatios.begin() + distRatios.size() / 2;
+    std::nth_element(distRatios.begin(), itMedian, distRatios.end());
+    double medDistRatio = *itMedian;
+
+    double dT = 1 / frameRate;
+    TTC = -dT / (1 - medDistRatio);
 }
 
 
-void computeTTCLidar(std::vector<LidarPoint> &lidarPointsPrev,
-                     std::vector<LidarPoint> &lidarPointsCurr, double frameRate, double &TTC)
+// median of the forward distance of all Lidar points in a range
+static double medianLidarX(const std::vector<LidarPoint> &lidarPoints, IndexSpan span)
 {
-    // ...
+    static thread_local vector<double> xValues;
+    xValues.clear();
+    for (int i = span.begin; i < span.begin + span.size; ++i)
+    {
+        xValues.push_back(lidarPoints[i].x);
+    }
+
+    auto itMedian = xValues.begin() + xValues.size() / 2;
+    std::nth_element(xValues.begin(), itMedian, xValues.end());
+    return *itMedian;
+}
+
+// Compute time-to-collision (TTC) based on the median distance of the Lidar points of an object in successive frames
+void computeTTCLidar(const std::vector<LidarPoint> &lidarPointsPrev, IndexSpan spanPrev,
+                     const std::vector<LidarPoint> &lidarPointsCurr, IndexSpan spanCurr, double frameRate, double &TTC)
+{
+    if (spanPrev.size == 0 || spanCurr.size == 0)
+    {
+        TTC = NAN;
+        return;
+    }
+
+    double dT = 1 / frameRate;
+    double xPrev = medianLidarX(lidarPointsPrev, spanPrev);
+    double xCurr = medianLidarX(lidarPointsCurr, spanCurr);
+
+    TTC = xCurr * dT / (xPrev - xCurr);
 }
 
 
-void matchBoundingBoxes(std::vector<cv::DMatch> &matches, std::map<int, int> &bbBestMatches, DataFrame &prevFrame, DataFrame &currFrame)
+// associate bounding boxes between previous and current frame by counting the keypoint matches they have in common;
+// pairs are assigned one-to-one, greedily in order of decreasing no. of shared matches, so that each box takes part in
+// at most one pair; bbBestMatches receives (prevBoxID, currBoxID) pairs ordered by prevBoxID
+void matchBoundingBoxes(const std::vector<cv::DMatch> &matches, std::vector<std::pair<int, int>> &bbBestMatches, const DataFrame &prevFrame, const DataFrame &currFrame)
 {
-    // ...
+    size_t nPrev = prevFrame.boundingBoxes.size(), nCurr = currFrame.boundingBoxes.size();
+
+    static thread_local vector<int> counts; // shared matches for each (prev, curr) box pair, row-major
+    counts.assign(nPrev * nCurr, 0);
+
+    for (auto it = matches.begin(); it != matches.end(); ++it)
+    {
+        const cv::Point2f &ptPrev = prevFrame.keypoints[it->queryIdx].pt;
+        const cv::Point2f &ptCurr = currFrame.keypoints[it->trainIdx].pt;
+
+        for (size_t i = 0; i < nPrev; ++i)
+        {
+            if (!prevFrame.boundingBoxes[i].roi.contains(ptPrev))
+            {
+                continue;
+            }
+            for (size_t j = 0; j < nCurr; ++j)
+            {
+                if (currFrame.boundingBoxes[j].roi.contains(ptCurr))
+                {
+                    ++counts[i * nCurr + j];
+                }
+            }
+        }
+    }
+
+    // all pairs with shared matches, most shared matches first (ties in box order to keep the result deterministic)
+    static thread_local vector<size_t> pairs; // indices into counts
+    pairs.clear();
+    for (size_t k = 0; k < counts.size(); ++k)
+    {
+        if (counts[k] > 0)
+        {
+            pairs.push_back(k);
+        }
+    }
+    sort(pairs.begin(), pairs.end(), [](size_t a, size_t b) { return counts[a] != counts[b] ? counts[a] > counts[b] : a < b; });
+
+    static thread_local vector<int> currOfPrev; // index of the current box assigned to each previous box, -1 if none
+    static thread_local vector<bool> bCurrAssigned;
+    currOfPrev.assign(nPrev, -1);
+    bCurrAssigned.assign(nCurr, false);
+    for (auto it = pairs.begin(); it != pairs.end(); ++it)
+    {
+        size_t i = *it / nCurr, j = *it % nCurr;
+        if (currOfPrev[i] < 0 && !bCurrAssigned[j])
+        {
+            currOfPrev[i] = (int)j;
+            bCurrAssigned[j] = true;
+        }
+    }
+
+    for (size_t i = 0; i < nPrev; ++i)
+    {
+        if (currOfPrev[i] >= 0)
+        {
+            bbBestMatches.push_back(make_pair(prevFrame.boundingBoxes[i].boxID, currFrame.boundingBoxes[currOfPrev[i]].boxID));
+        }
+    }
 }
@@ -3,38 +3,52 @@
 #define dataStructures_h
 
 #include <vector>
-#include <map>
+#include <utility>
 #include <opencv2/core.hpp>
 
 struct LidarPoint { // single lidar point in space
     double x,y,z,r; // x,y,z in [m], r is point reflectivity
 };
 
+struct IndexSpan { // contiguous range [begin, begin+size) of elements in an array owned by a DataFrame
+    int begin = 0;
+    int size = 0;
+};
+
 struct BoundingBox { // bounding box around a classified object (contains both 2D and 3D data)
     
-    int boxID; // unique identifier for this bounding box
-    int trackID; // unique identifier for the track to which this bounding box belongs
+    int boxID; // unique identifier for this bounding box, equal to its position within DataFrame::boundingBoxes
+    int trackID = -1; // unique identifier for the track to which this bounding box belongs, -1 if not tracked
     
     cv::Rect roi; // 2D region-of-interest in image coordinates
     int classID; // ID based on class file provided to YOLO framework
     double confidence; // classification trust
 
-    std::vector<LidarPoint> lidarPoints; // Lidar 3D points which project into 2D image roi
-    std::vector<cv::KeyPoint> keypoints; // keypoints enclosed by 2D roi
-    std::vector<cv::DMatch> kptMatches; // keypoint matches enclosed by 2D roi
+    IndexSpan lidarPoints; // Lidar 3D points which project into 2D image roi (range in DataFrame::lidarPoints)
+    IndexSpan kptMatches; // keypoint matches enclosed by 2D roi (range in DataFrame::kptMatches, enclosed keypoints via trainIdx)
+};
+
+struct TTCResult { // time-to-collision estimates for a bounding box matched between previous and current frame
+    int boxID; // bounding box in the current frame
+    int prevBoxID; // matched bounding box in the previous frame
+    double ttcLidar; // TTC based on Lidar points in [s], NaN if not available
+    double ttcCamera; // TTC based on keypoint matches in [s], NaN if not available
 };
 
 struct DataFrame { // represents the available sensor information at the same time instance
     
+    double timestamp; // acquisition time of camera image and Lidar scan in [s]
     cv::Mat cameraImg; // camera image
     
     std::vector<cv::KeyPoint> keypoints; // 2D keypoints within camera image
     cv::Mat descriptors; // keypoint descriptors
-    std::vector<cv::DMatch> kptMatches; // keypoint matches between previous and current frame
-    std::vector<LidarPoint> lidarPoints;
+    std::vector<cv::DMatch> kptMatches; // keypoint matches between previous and current frame, grouped by bounding box after clustering
+    std::vector<LidarPoint> lidarPoints; // cropped Lidar points, grouped by bounding box after clustering
+    std::vector<cv::Point3f> lidarProjections; // image position (u, v) and depth of each Lidar point, same order as lidarPoints
 
     std::vector<BoundingBox> boundingBoxes; // ROI around detected objects in 2D image coordinates
-    std::map<int,int> bbMatches; // bounding box matches between previous and current frame
+    std::vector<std::pair<int,int>> bbMatches; // bounding box matches (prevBoxID, currBoxID) between previous and current frame, ordered by prevBoxID
+    std::vector<TTCResult> ttcResults; // TTC for all matched bounding boxes with Lidar points, ordered by boxID
 };
 
 #endif /* dataStructures_h */
@@ -0,0 +1,155 @@
+
+#ifndef featurePipeline_hpp
+#define featurePipeline_hpp
+
+#include <stdio.h>
+#include <iostream>
+#include <vector>
+
+#include <opencv2/core.hpp>
+#include <opencv2/features2d.hpp>
+#include <opencv2/flann.hpp>
+#include <opencv2/xfeatures2d.hpp>
+#include <opencv2/xfeatures2d/nonfree.hpp>
+
+#include "matching2D.hpp"
+
+// Keypoint detection, description and matching with the combination of methods fixed at compile time.
+// All OpenCV algorithm objects are created once when the pipeline is constructed and re-used for every frame,
+// and the descriptor element type and norm are known statically in the matching code.
+
+enum class DetectorType { SHITOMASI, FAST, BRISK, ORB, AKAZE, SIFT };
+enum class DescriptorType { BRISK, BRIEF, ORB, FREAK, AKAZE, SIFT };
+enum class MatcherType { BF, FLANN };
+enum class SelectorType { NN, KNN };
+
+template <DetectorType D> struct DetectorTraits
+{
+    static cv::Ptr<cv::FeatureDetector> create();
+};
+
+template <> inline cv::Ptr<cv::FeatureDetector> DetectorTraits<DetectorType::SHITOMASI>::create() { return cv::Ptr<cv::FeatureDetector>(); } // see detect()
+template <> inline cv::Ptr<cv::FeatureDetector> DetectorTraits<DetectorType::FAST>::create() { return cv::FastFeatureDetector::create(30, true); }
+template <> inline cv::Ptr<cv::FeatureDetector> DetectorTraits<DetectorType::BRISK>::create() { return cv::BRISK::create(30, 3, 1.0f); }
+template <> inline cv::Ptr<cv::FeatureDetector> DetectorTraits<DetectorType::ORB>::create() { return cv::ORB::create(); }
+template <> inline cv::Ptr<cv::FeatureDetector> DetectorTraits<DetectorType::AKAZE>::create() { return cv::AKAZE::create(); }
+template <> inline cv::Ptr<cv::FeatureDetector> DetectorTraits<DetectorType::SIFT>::create() { return cv::xfeatures2d::SIFT::create(); }
+
+template <DescriptorType D> struct DescriptorTraits // binary descriptors : bit strings compared by Hamming distance
+{
+    typedef unsigned char ElemType;
+    static const int normType = cv::NORM_HAMMING;
+    static cv::Ptr<cv::DescriptorExtractor> create();
+};
+
+template <> struct DescriptorTraits<DescriptorType::SIFT> // gradient histograms compared by L2 distance
+{
+    typedef float ElemType;
+    static const int normType = cv::NORM_L2;
+    static cv::Ptr<cv::DescriptorExtractor> create() { return cv::xfeatures2d::SIFT::create(); }
+};
+
+template <> inline cv::Ptr<cv::DescriptorExtractor> DescriptorTraits<DescriptorType::BRISK>::create() { return cv::BRISK::create(30, 3, 1.0f); }
+template <> inline cv::Ptr<cv::DescriptorExtractor> DescriptorTraits<DescriptorType::BRIEF>::create() { return cv::xfeatures2d::BriefDescriptorExtractor::create(32); }
+template <> inline cv::Ptr<cv::DescriptorExtractor> DescriptorTraits<DescriptorType::ORB>::create() { return cv::ORB::create(); }
+template <> inline cv::Ptr<cv::DescriptorExtractor> DescriptorTraits<DescriptorType::FREAK>::create() { return cv::xfeatures2d::FREAK::create(); }
+template <> inline cv::Ptr<cv::DescriptorExtractor> DescriptorTraits<DescriptorType::AKAZE>::create() { return cv::AKAZE::create(); }
+
+template <DetectorType Det, DescriptorType Desc, MatcherType Mat, SelectorType Sel>
+class FeaturePipeline
+{
+public:
+    static_assert(Desc != DescriptorType::AKAZE || Det == DetectorType::AKAZE, "AKAZE descriptors require AKAZE keypoints");
+
+    typedef typename DescriptorTraits<Desc>::ElemType DescriptorElemType;
+    static const DetectorType detectorType = Det;
+    static const DescriptorType descriptorType = Desc;
+
+    explicit FeaturePipeline(bool bVerbose = true) // bVerbose : report timings on cout
+        : detector(DetectorTraits<Det>::create()), extractor(DescriptorTraits<Desc>::create()), matcher(createMatcher()), bVerbose(bVerbose)
+    {
+    }
+
+    // detect keypoints in a grayscale image and append them to keypoints
+    void detect(cv::Mat &imgGray, std::vector<cv::KeyPoint> &keypoints)
+    {
+        if (Det == DetectorType::SHITOMASI)
+        {
+            detKeypointsShiTomasi(keypoints, imgGray, false, bVerbose);
+            return;
+        }
+
+        double t = (double)cv::getTickCount();
+        detector->detect(imgGray, keypoints);
+        t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+        if (bVerbose)
+        {
+            std::cout << "Keypoint detection with n=" << keypoints.size() << " keypoints in " << 1000 * t / 1.0 << " ms" << std::endl;
+        }
+    }
+
+    // compute descriptors for keypoints (keypoints for which no descriptor can be computed are removed)
+    void describe(std::vector<cv::KeyPoint> &keypoints, cv::Mat &img, cv::Mat &descriptors)
+    {
+        double t = (double)cv::getTickCount();
+        extractor->compute(img, keypoints, descriptors);
+        t = ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+        if (bVerbose)
+        {
+            std::cout << "Descriptor extraction in " << 1000 * t / 1.0 << " ms" << std::endl;
+        }
+    }
+
+    // find best matches of source descriptors (previous frame) in reference descriptors (current frame)
+    void match(const cv::Mat &descSource, const cv::Mat &descRef, std::vector<cv::DMatch> &matches)
+    {
+        matches.clear();
+        if (descSource.empty() || descRef.empty())
+        {
+            return;
+        }
+        CV_Assert(descSource.depth() == cv::DataType<DescriptorElemType>::depth && descRef.depth() == cv::DataType<DescriptorElemType>::depth);
+
+        if (Sel == SelectorType::NN)
+        { // nearest neighbor (best match)
+            matcher->match(descSource, descRef, matches);
+            return;
+        }
+
+        // k nearest neighbors (k=2) with distance ratio test; the candidate list keeps its capacity across frames
+        const float minDescDistRatio = 0.8;
+        matcher->knnMatch(descSource, descRef, knnMatches, 2);
+        for (auto it = knnMatches.begin(); it != knnMatches.end(); ++it)
+        {
+            if (it->size() == 2 && (*it)[0].distance < minDescDistRatio * (*it)[1].distance)
+            {
+                matches.push_back((*it)[0]);
+            }
+        }
+    }
+
+private:
+    static cv::Ptr<cv::DescriptorMatcher> createMatcher()
+    {
+        if (Mat == MatcherType::BF)
+        {
+            bool crossCheck = false;
+            return cv::BFMatcher::create(DescriptorTraits<Desc>::normType, crossCheck);
+        }
+
+        // FLANN uses a KD-tree for float descriptors and locality-sensitive hashing for binary descriptors
+        if (DescriptorTraits<Desc>::normType == cv::NORM_HAMMING)
+        {
+            return cv::makePtr<cv::FlannBasedMatcher>(cv::makePtr<cv::flann::LshIndexParams>(12, 20, 2));
+        }
+        return cv::FlannBasedMatcher::create();
+    }
+
+    cv::Ptr<cv::FeatureDetector> detector;
+    cv::Ptr<cv::DescriptorExtractor> extractor;
+    cv::Ptr<cv::DescriptorMatcher> matcher;
+    std::vector<std::vector<cv::DMatch>> knnMatches;
+    bool bVerbose;
+};
+
+#endif /* featurePipeline_hpp */
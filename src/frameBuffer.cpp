@@ -0,0 +1,83 @@
+#include <cstdio>
+#include <iostream>
+#include <opencv2/imgcodecs.hpp>
+
+#include "frameBuffer.hpp"
+
+using namespace std;
+
+// per-object lists are reserved up front, so that they do not grow during the first frames
+static const size_t reservedObjectsPerFrame = 64;
+
+FrameBuffer::FrameBuffer(size_t capacity) : slots(capacity < 2 ? 2 : capacity), head(0), count(0)
+{
+    for (auto it = slots.begin(); it != slots.end(); ++it)
+    {
+        it->boundingBoxes.reserve(reservedObjectsPerFrame);
+        it->bbMatches.reserve(reservedObjectsPerFrame);
+        it->ttcResults.reserve(reservedObjectsPerFrame);
+    }
+}
+
+DataFrame &FrameBuffer::acquire()
+{
+    head = (head + 1) % slots.size();
+    count = count < slots.size() ? count + 1 : count;
+
+    resetDataFrame(slots[head]);
+    return slots[head];
+}
+
+DataFrame &FrameBuffer::current()
+{
+    return slots[head];
+}
+
+DataFrame &FrameBuffer::previous()
+{
+    return slots[(head + slots.size() - 1) % slots.size()];
+}
+
+size_t FrameBuffer::size() const
+{
+    return count;
+}
+
+
+void resetDataFrame(DataFrame &frame)
+{
+    // vectors keep their capacity on clear(), cv::Mat keeps its buffer as long as size and type do not change
+    frame.keypoints.clear();
+    frame.kptMatches.clear();
+    frame.lidarPoints.clear();
+    frame.lidarProjections.clear();
+    frame.boundingBoxes.clear();
+    frame.bbMatches.clear();
+    frame.ttcResults.clear();
+}
+
+
+bool loadImageFromFile(std::vector<unsigned char> &fileBuffer, cv::Mat &img, const std::string &filename)
+{
+    FILE *stream = fopen(filename.c_str(), "rb");
+    if (stream == nullptr)
+    {
+        cerr << "Unable to open image file " << filename << endl;
+        return false;
+    }
+
+    fseek(stream, 0, SEEK_END);
+    long fileSize = ftell(stream);
+    fseek(stream, 0, SEEK_SET);
+    fileBuffer.resize(fileSize > 0 ? fileSize : 0);
+    bool bRead = fileSize > 0 && fread(fileBuffer.data(), 1, fileBuffer.size(), stream) == fileBuffer.size();
+    fclose(stream);
+
+    // decoding into an existing matrix of the same size and type re-uses its buffer
+    if (!bRead || cv::imdecode(fileBuffer, cv::IMREAD_COLOR, &img).empty())
+    {
+        cerr << "Unable to read image file " << filename << endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,35 @@
+
+#ifndef frameBuffer_hpp
+#define frameBuffer_hpp
+
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+
+// fixed-size ring buffer of data frames; slots are recycled instead of re-allocated so that the containers
+// inside a frame keep their capacity and do not have to be grown again in steady-state frames
+class FrameBuffer
+{
+public:
+    explicit FrameBuffer(size_t capacity);
+
+    DataFrame &acquire();   // reset the oldest slot in one step and make it the current frame
+    DataFrame &current();   // most recently acquired frame
+    DataFrame &previous();  // frame acquired before the current one (requires size() > 1)
+    size_t size() const;    // no. of valid frames held in the buffer
+
+private:
+    std::vector<DataFrame> slots;
+    size_t head;  // index of the current frame
+    size_t count; // no. of valid frames
+};
+
+void resetDataFrame(DataFrame &frame); // clear all frame contents while keeping the allocated capacity
+
+// read an encoded image file into fileBuffer and decode it into img; both keep their buffers across calls as long as
+// file size and image size do not grow, returns false if the file could not be read or decoded
+bool loadImageFromFile(std::vector<unsigned char> &fileBuffer, cv::Mat &img, const std::string &filename);
+
+#endif /* frameBuffer_hpp */
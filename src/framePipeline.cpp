@@ -0,0 +1,291 @@
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cassert>
+#include <opencv2/imgproc/imgproc.hpp>
+
+#include "framePipeline.hpp"
+#include "lidarData.hpp"
+#include "camFusion.hpp"
+
+using namespace std;
+
+// seconds since tick count t, which is reset to the current tick count
+static double lapTime(double &t)
+{
+    double tNow = (double)cv::getTickCount();
+    double dt = (tNow - t) / cv::getTickFrequency();
+    t = tNow;
+    return dt;
+}
+
+FramePipeline::FramePipeline(const FramePipelineConfig &config, ObjectDetector &objectDetector, ObjectDetector *lightObjectDetector, ThreadPool &threadPool)
+    : config(config), objectDetector(objectDetector), lightObjectDetector(lightObjectDetector), threadPool(threadPool),
+      featurePipeline(config.bVerbose), trackManager(config.minGateIoU, config.ttcSmoothingFactor, config.maxTrackMisses)
+{
+}
+
+const FramePipelineConfig &FramePipeline::getConfig() const
+{
+    return config;
+}
+
+const TrackManager &FramePipeline::getTrackManager() const
+{
+    return trackManager;
+}
+
+double FramePipeline::processFrame(FrameBuffer &dataBuffer, QualityLevel qualityLevel, FrameCaptures *captures, StageTimes *times)
+{
+    DataFrame &frame = dataBuffer.current();
+    StageTimes noTimes;
+    times = times != nullptr ? times : &noTimes;
+    double t = (double)cv::getTickCount();
+
+    /* DETECT & CLASSIFY OBJECTS */
+
+    if (qualityLevel == QualityLevel::SKIP_DETECTION && dataBuffer.size() > 1)
+    {
+        // objects move little between frames, so re-use the boxes of the previous frame
+        const vector<BoundingBox> &prevBoxes = dataBuffer.previous().boundingBoxes;
+        for (auto it = prevBoxes.begin(); it != prevBoxes.end(); ++it)
+        {
+            BoundingBox bBox;
+            bBox.boxID = (int)frame.boundingBoxes.size(); // boxID is the position within the box list
+            assert(bBox.boxID == it->boxID);
+            bBox.roi = it->roi;
+            bBox.classID = it->classID;
+            bBox.confidence = it->confidence;
+            frame.boundingBoxes.push_back(bBox);
+        }
+
+        if (config.bVerbose)
+        {
+            cout << "#2 : DETECT & CLASSIFY OBJECTS skipped (boxes of previous frame re-used)" << endl;
+        }
+    }
+    else
+    {
+        bool bLight = qualityLevel >= QualityLevel::LIGHT_DETECTOR && lightObjectDetector != nullptr;
+        ObjectDetector &detector = bLight ? *lightObjectDetector : objectDetector;
+        detector.detect(frame.cameraImg, frame.boundingBoxes, config.confThreshold, config.nmsThreshold, config.bVis);
+
+        if (config.bVerbose)
+        {
+            cout << "#2 : DETECT & CLASSIFY OBJECTS done" << endl;
+        }
+    }
+    times->detection += lapTime(t);
+
+
+    /* CROP LIDAR POINTS */
+
+    // remove Lidar points based on distance properties
+    cropLidarPoints(frame.lidarPoints, config.minX, config.maxX, config.maxY, config.minZ, config.maxZ, config.minR);
+
+    if (config.bVerbose)
+    {
+        cout << "#3 : CROP LIDAR POINTS done" << endl;
+    }
+
+    // optional : keep one point per voxel so that downstream cost depends on occupied space rather than raw point count
+    if (config.bDownsample)
+    {
+        if (captures != nullptr && captures->fullLidarPoints != nullptr)
+        {
+            *captures->fullLidarPoints = frame.lidarPoints;
+        }
+
+        size_t nPointsFull = frame.lidarPoints.size();
+        downsampleLidarPoints(frame.lidarPoints, config.voxelLeafSize);
+        if (config.bVerbose)
+        {
+            cout << "#3 : DOWNSAMPLE LIDAR POINTS done (" << nPointsFull << " -> " << frame.lidarPoints.size() << " points)" << endl;
+        }
+    }
+
+    // project all remaining points into the camera once, clustering and visualization re-use the projections
+    projectLidarPoints(frame.lidarPoints, frame.lidarProjections, config.P_rect_xx, config.R_rect_xx, config.RT);
+
+
+    /* CLUSTER LIDAR POINT CLOUD */
+
+    // associate Lidar points with camera-based ROI
+    if (captures != nullptr && captures->lidarPointsIn != nullptr)
+    {
+        *captures->lidarPointsIn = frame.lidarPoints;
+    }
+    if (captures != nullptr && captures->kptMatchesIn != nullptr)
+    {
+        captures->kptMatchesIn->clear();
+    }
+    clusterLidarWithROI(frame.boundingBoxes, frame.lidarPoints, frame.lidarProjections, config.shrinkFactor);
+
+    // keep only the dominant 3D cluster of each box to remove ground returns, background and neighboring objects
+    if (config.bFilterClusters)
+    {
+        threadPool.parallelFor(frame.boundingBoxes.size(), [&](size_t i) {
+            keepDominantLidarCluster(frame.lidarPoints, frame.lidarProjections, frame.boundingBoxes[i].lidarPoints, config.clusterTolerance);
+        });
+    }
+
+    // Visualize 3D objects
+    if (config.bVis)
+    {
+        show3DObjects(frame.boundingBoxes, frame.lidarPoints, cv::Size(4.0, 20.0), cv::Size(2000, 2000), true);
+    }
+
+    if (config.bVerbose)
+    {
+        cout << "#4 : CLUSTER LIDAR POINT CLOUD done" << endl;
+    }
+    times->lidar += lapTime(t);
+
+
+    /* DETECT IMAGE KEYPOINTS */
+
+    // convert current image to grayscale (re-uses the buffer of the previous frame)
+    cv::cvtColor(frame.cameraImg, imgGray, cv::COLOR_BGR2GRAY);
+
+    // extract 2D keypoints from current image directly into the (empty) feature list of the frame slot
+    vector<cv::KeyPoint> &keypoints = frame.keypoints;
+    featurePipeline.detect(imgGray, keypoints);
+
+    // optional : limit number of keypoints (helpful for debugging and learning, or to save time in real-time mode)
+    if (config.bLimitKpts || qualityLevel >= QualityLevel::REDUCED_KEYPOINTS)
+    {
+        int maxKeypoints = config.bLimitKpts ? config.maxKeypoints : config.maxKeypointsDegraded;
+
+        if (FeaturePipelineType::detectorType == DetectorType::SHITOMASI && (int)keypoints.size() > maxKeypoints)
+        { // there is no response info, so keep the first ones as they are sorted in descending quality order
+            keypoints.erase(keypoints.begin() + maxKeypoints, keypoints.end());
+        }
+        cv::KeyPointsFilter::retainBest(keypoints, maxKeypoints);
+        if (config.bVerbose)
+        {
+            cout << " NOTE: Keypoints have been limited!" << endl;
+        }
+    }
+
+    if (config.bVerbose)
+    {
+        cout << "#5 : DETECT KEYPOINTS done" << endl;
+    }
+
+
+    /* EXTRACT KEYPOINT DESCRIPTORS */
+
+    // descriptors are written into the frame slot, whose buffer is re-used when size and type match
+    featurePipeline.describe(frame.keypoints, frame.cameraImg, frame.descriptors);
+
+    if (config.bVerbose)
+    {
+        cout << "#6 : EXTRACT DESCRIPTORS done" << endl;
+    }
+    times->keypoints += lapTime(t);
+
+
+    // frames need a later timestamp than their predecessor (a misbehaving publisher may repeat or reorder them)
+    double frameRate = config.nominalFrameRate; // 1 / time between previous and current frame
+    bool bValidInterval = dataBuffer.size() > 1 && frame.timestamp > dataBuffer.previous().timestamp;
+    if (dataBuffer.size() > 1 && !bValidInterval && config.bVerbose)
+    {
+        cout << "#7 : MATCH KEYPOINT DESCRIPTORS skipped (timestamp not after previous frame)" << endl;
+    }
+
+    if (bValidInterval) // wait until at least two images have been processed
+    {
+
+        /* MATCH KEYPOINT DESCRIPTORS */
+
+        DataFrame &prevFrame = dataBuffer.previous();
+        frameRate = 1.0 / (frame.timestamp - prevFrame.timestamp); // true rate, frames may have been dropped
+
+        // matches are stored directly in current data frame
+        featurePipeline.match(prevFrame.descriptors, frame.descriptors, frame.kptMatches);
+
+        if (config.bVerbose)
+        {
+            cout << "#7 : MATCH KEYPOINT DESCRIPTORS done" << endl;
+        }
+
+
+        /* TRACK 3D OBJECT BOUNDING BOXES */
+
+        //// STUDENT ASSIGNMENT
+        //// TASK FP.1 -> match list of 3D objects (vector<BoundingBox>) between current and previous frame (implement ->matchBoundingBoxes)
+        matchBoundingBoxes(frame.kptMatches, frame.bbMatches, prevFrame, frame); // associate bounding boxes between current and previous frame using keypoint matches
+        //// EOF STUDENT ASSIGNMENT
+
+        if (config.bVerbose)
+        {
+            cout << "#8 : TRACK 3D OBJECT BOUNDING BOXES done" << endl;
+        }
+
+
+        /* COMPUTE TTC ON OBJECT IN FRONT */
+
+        //// STUDENT ASSIGNMENT
+        //// TASK FP.3 -> assign enclosed keypoint matches to bounding boxes (implement -> clusterKptMatchesWithROI)
+        if (captures != nullptr && captures->kptMatchesIn != nullptr)
+        {
+            *captures->kptMatchesIn = frame.kptMatches;
+        }
+        clusterKptMatchesWithROI(frame.boundingBoxes, prevFrame.keypoints, frame.keypoints, frame.kptMatches);
+        //// EOF STUDENT ASSIGNMENT
+        times->matching += lapTime(t);
+
+        // collect all BB match pairs with Lidar points in both frames, ordered by boxID
+        for (auto it1 = frame.bbMatches.begin(); it1 != frame.bbMatches.end(); ++it1)
+        {
+            // find bounding boxes associates with current match (boxID is the position within the frame's box list)
+            const BoundingBox &prevBB = prevFrame.boundingBoxes[it1->first];
+            const BoundingBox &currBB = frame.boundingBoxes[it1->second];
+
+            if( currBB.lidarPoints.size>0 && prevBB.lidarPoints.size>0 ) // only compute TTC if we have Lidar points
+            {
+                TTCResult result;
+                result.boxID = currBB.boxID;
+                result.prevBoxID = prevBB.boxID;
+                result.ttcLidar = result.ttcCamera = NAN;
+                frame.ttcResults.push_back(result);
+            }
+        }
+        sort(frame.ttcResults.begin(), frame.ttcResults.end(), [](const TTCResult &a, const TTCResult &b) {
+            return a.boxID != b.boxID ? a.boxID < b.boxID : a.prevBoxID < b.prevBoxID;
+        });
+
+        // compute TTC for all objects in parallel, each task only writes its own result slot
+        threadPool.parallelFor(frame.ttcResults.size(), [&](size_t i) {
+            TTCResult &result = frame.ttcResults[i];
+            const BoundingBox &prevBB = prevFrame.boundingBoxes[result.prevBoxID];
+            const BoundingBox &currBB = frame.boundingBoxes[result.boxID];
+
+            //// STUDENT ASSIGNMENT
+            //// TASK FP.2 -> compute time-to-collision based on Lidar data (implement -> computeTTCLidar)
+            computeTTCLidar(prevFrame.lidarPoints, prevBB.lidarPoints, frame.lidarPoints, currBB.lidarPoints, frameRate, result.ttcLidar);
+            //// EOF STUDENT ASSIGNMENT
+
+            //// STUDENT ASSIGNMENT
+            //// TASK FP.4 -> compute time-to-collision based on camera (implement -> computeTTCCamera)
+            computeTTCCamera(prevFrame.keypoints, frame.keypoints, frame.kptMatches, currBB.kptMatches, frameRate, result.ttcCamera);
+            //// EOF STUDENT ASSIGNMENT
+        });
+
+    }
+
+
+    /* UPDATE OBJECT TRACKS */
+
+    // associate boxes with persistent tracks (gated by class and overlap with the predicted roi) and smooth the TTC
+    const vector<BoundingBox> &prevBoundingBoxes = dataBuffer.size() > 1 ? dataBuffer.previous().boundingBoxes : noBoundingBoxes;
+    trackManager.update(prevBoundingBoxes, frame.boundingBoxes, frame.bbMatches, frame.ttcResults, 1 / frameRate);
+
+    if (config.bVerbose)
+    {
+        cout << "#9 : UPDATE OBJECT TRACKS done (" << trackManager.getTracks().size() << " tracks)" << endl;
+    }
+    times->ttc += lapTime(t);
+
+    return frameRate;
+}
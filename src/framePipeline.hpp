@@ -0,0 +1,94 @@
+
+#ifndef framePipeline_hpp
+#define framePipeline_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "objectDetection2D.hpp"
+#include "frameBuffer.hpp"
+#include "threadPool.hpp"
+#include "trackManager.hpp"
+#include "featurePipeline.hpp"
+#include "realTimeScheduler.hpp"
+
+// keypoint detector, descriptor and matching strategy are selected at compile time, the pipeline creates all
+// OpenCV algorithm objects once (detectors : SHITOMASI, FAST, BRISK, ORB, AKAZE, SIFT; descriptors : BRISK, BRIEF,
+// ORB, FREAK, AKAZE, SIFT; matchers : BF, FLANN; selectors : NN, KNN)
+typedef FeaturePipeline<DetectorType::SHITOMASI, DescriptorType::BRISK, MatcherType::BF, SelectorType::NN> FeaturePipelineType;
+
+struct FramePipelineConfig { // parameters of all per-frame stages, shared by the main program and the batch driver
+
+    // object detection
+    float confThreshold = 0.2;
+    float nmsThreshold = 0.4;
+
+    // Lidar : crop to the ego lane, optional voxel-grid downsampling, association with the boxes
+    float minZ = -1.5, maxZ = -0.9, minX = 2.0, maxX = 20.0, maxY = 2.0, minR = 0.1;
+    bool bDownsample = false;
+    float voxelLeafSize = 0.1;      // edge length of a voxel in [m]
+    float shrinkFactor = 0.10;      // shrinks each bounding box by the given percentage to avoid 3D object merging at the edges of an ROI
+    bool bFilterClusters = false;   // keep only the dominant 3D cluster of each box
+    float clusterTolerance = 0.3;   // max. distance between neighboring points of the same object in [m]
+    cv::Mat P_rect_xx, R_rect_xx, RT; // calibration of camera and Lidar
+
+    // keypoints
+    bool bLimitKpts = false;        // limit no. of keypoints (helpful for debugging and learning)
+    int maxKeypoints = 50;
+    int maxKeypointsDegraded = 300; // keypoint budget from quality level REDUCED_KEYPOINTS on
+
+    // tracking
+    double nominalFrameRate = 10.0; // frames per second, used when the time between frames is not known
+    double minGateIoU = 0.3;        // min. IoU of the association gate
+    double ttcSmoothingFactor = 0.3; // weight of new TTC measurements
+    int maxTrackMisses = 3;         // max. missed frames of a track
+
+    bool bVis = false;              // visualize intermediate results (blocks the pipeline)
+    bool bVerbose = true;           // progress output on cout
+};
+
+struct StageTimes { // accumulated processing time per pipeline stage in [s]
+    double detection = 0.0;  // object detection
+    double lidar = 0.0;      // cropping, downsampling and clustering of the Lidar points
+    double keypoints = 0.0;  // keypoint detection and description
+    double matching = 0.0;   // keypoint matching, bounding box matching and clustering of matches
+    double ttc = 0.0;        // TTC computation and track update
+    double total = 0.0;      // whole frames, including loading of the sensor data
+};
+
+struct FrameCaptures { // optional copies of stage inputs for recording and diagnostics, nullptr if not needed
+    std::vector<LidarPoint> *lidarPointsIn = nullptr;   // Lidar points as passed into clusterLidarWithROI
+    std::vector<cv::DMatch> *kptMatchesIn = nullptr;    // keypoint matches as passed into clusterKptMatchesWithROI
+    std::vector<LidarPoint> *fullLidarPoints = nullptr; // cropped Lidar points before downsampling
+};
+
+// all processing stages of one frame, from object detection to the track update; keeps the objects which persist
+// across frames (feature pipeline, tracks, scratch buffers)
+class FramePipeline
+{
+public:
+    // lightObjectDetector is used from quality level LIGHT_DETECTOR on and may be nullptr; tasks within a frame are
+    // distributed over threadPool, which must not be shared with a loop which is running at the same time
+    FramePipeline(const FramePipelineConfig &config, ObjectDetector &objectDetector, ObjectDetector *lightObjectDetector, ThreadPool &threadPool);
+
+    // process the current frame of the buffer, whose timestamp, camera image and Lidar scan have been loaded;
+    // returns the frame rate passed to the TTC estimators
+    double processFrame(FrameBuffer &dataBuffer, QualityLevel qualityLevel, FrameCaptures *captures, StageTimes *times);
+
+    const FramePipelineConfig &getConfig() const;
+    const TrackManager &getTrackManager() const;
+
+private:
+    FramePipelineConfig config;
+    ObjectDetector &objectDetector;
+    ObjectDetector *lightObjectDetector;
+    ThreadPool &threadPool;
+    FeaturePipelineType featurePipeline;
+    TrackManager trackManager;
+    cv::Mat imgGray; // re-used across frames
+    const std::vector<BoundingBox> noBoundingBoxes; // stands in for the previous frame's boxes on the first frame
+};
+
+#endif /* framePipeline_hpp */
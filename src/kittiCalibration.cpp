@@ -0,0 +1,94 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <vector>
+
+#include "kittiCalibration.hpp"
+
+using namespace std;
+
+// parse "key: v1 v2 ..." lines, lines without numeric values (e.g. calib_time) are ignored
+static bool readCalibrationFile(const std::string &filename, map<string, vector<double>> &entries)
+{
+    ifstream ifs(filename.c_str());
+    if (!ifs)
+    {
+        cerr << "Unable to open calibration file " << filename << endl;
+        return false;
+    }
+
+    string line;
+    while (getline(ifs, line))
+    {
+        size_t colon = line.find(':');
+        if (colon == string::npos)
+        {
+            continue;
+        }
+
+        istringstream values(line.substr(colon + 1));
+        vector<double> numbers;
+        double value;
+        while (values >> value)
+        {
+            numbers.push_back(value);
+        }
+        if (values.eof() && !numbers.empty())
+        {
+            entries[line.substr(0, colon)] = numbers;
+        }
+    }
+    return true;
+}
+
+static bool findEntry(const map<string, vector<double>> &entries, const string &key, size_t nValues, const string &filename,
+                      const vector<double> *&values)
+{
+    auto it = entries.find(key);
+    if (it == entries.end() || it->second.size() != nValues)
+    {
+        cerr << "Missing or invalid entry " << key << " in calibration file " << filename << endl;
+        return false;
+    }
+    values = &it->second;
+    return true;
+}
+
+bool loadKittiCalibration(const std::string &camToCamFile, const std::string &veloToCamFile, const std::string &cameraID,
+                          cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT)
+{
+    map<string, vector<double>> camToCam, veloToCam;
+    if (!readCalibrationFile(camToCamFile, camToCam) || !readCalibrationFile(veloToCamFile, veloToCam))
+    {
+        return false;
+    }
+
+    const vector<double> *P, *R_rect, *R, *T;
+    if (!findEntry(camToCam, "P_rect_" + cameraID, 12, camToCamFile, P) || !findEntry(camToCam, "R_rect_00", 9, camToCamFile, R_rect) ||
+        !findEntry(veloToCam, "R", 9, veloToCamFile, R) || !findEntry(veloToCam, "T", 3, veloToCamFile, T))
+    {
+        return false;
+    }
+
+    // 3x4 projection matrix after rectification
+    P_rect_xx.create(3, 4, cv::DataType<double>::type);
+    for (int i = 0; i < 12; ++i)
+    {
+        P_rect_xx.at<double>(i / 4, i % 4) = (*P)[i];
+    }
+
+    // 3x3 rectifying rotation and [R | T] from Lidar into camera, both extended to homogeneous 4x4 matrices
+    R_rect_xx = cv::Mat::eye(4, 4, cv::DataType<double>::type);
+    RT = cv::Mat::eye(4, 4, cv::DataType<double>::type);
+    for (int i = 0; i < 9; ++i)
+    {
+        R_rect_xx.at<double>(i / 3, i % 3) = (*R_rect)[i];
+        RT.at<double>(i / 3, i % 3) = (*R)[i];
+    }
+    for (int i = 0; i < 3; ++i)
+    {
+        RT.at<double>(i, 3) = (*T)[i];
+    }
+    return true;
+}
@@ -0,0 +1,16 @@
+
+#ifndef kittiCalibration_hpp
+#define kittiCalibration_hpp
+
+#include <stdio.h>
+#include <string>
+#include <opencv2/core.hpp>
+
+// read camera and Lidar calibration from the files of a KITTI raw data recording day : calib_cam_to_cam.txt provides
+// the rectified projection of camera cameraID (e.g. "00") and the rectifying rotation R_rect_00, calib_velo_to_cam.txt
+// the rotation R and translation T from the Lidar into the reference camera. The matrices are returned in the layout
+// used by the pipeline (P_rect_xx 3x4, R_rect_xx and RT 4x4, homogeneous).
+bool loadKittiCalibration(const std::string &camToCamFile, const std::string &veloToCamFile, const std::string &cameraID,
+                          cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT);
+
+#endif /* kittiCalibration_hpp */
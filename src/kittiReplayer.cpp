@@ -0,0 +1,98 @@
+/* PUBLISH THE BUNDLED KITTI SEQUENCE AS A LIVE SENSOR STREAM */
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <csignal>
+#include <cstdlib>
+#include <opencv2/core.hpp>
+#include <opencv2/highgui/highgui.hpp>
+
+#include "dataStructures.h"
+#include "lidarData.hpp"
+#include "sensorStream.hpp"
+
+using namespace std;
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 3)
+    {
+        cout << "usage : " << argv[0] << " <UNIX_SOCKET|FIFO> <path> [shmName] [rate]" << endl;
+        return 1;
+    }
+    string endpointType = argv[1];
+    string endpointPath = argv[2];
+    string shmName = argc > 3 ? argv[3] : "/sfnd_camera";
+    double sensorRate = argc > 4 ? atof(argv[4]) : 10.0; // frames per second of camera and Lidar
+
+    // data location (same layout as the main program)
+    string dataPath = "../";
+    string imgBasePath = dataPath + "images/";
+    string imgPrefix = "KITTI/2011_09_26/image_02/data/000000";
+    string imgFileType = ".png";
+    string lidarPrefix = "KITTI/2011_09_26/velodyne_points/data/000000";
+    string lidarFileType = ".bin";
+    int imgStartIndex = 0;
+    int imgEndIndex = 18;
+    int imgFillWidth = 4;
+
+    // image slots sized for KITTI color images, a few more than the receiver holds at a time
+    size_t nSlots = 8;
+    size_t slotSize = 1242 * 375 * 3;
+
+    signal(SIGPIPE, SIG_IGN); // a vanished receiver shows up as a failed write instead
+    SensorStreamPublisher publisher;
+    if (!publisher.open(endpointType, endpointPath, shmName, nSlots, slotSize))
+    {
+        return 1;
+    }
+
+    vector<LidarPoint> lidarPoints;
+    size_t nDroppedImages = 0, nDroppedScans = 0;
+    chrono::steady_clock::time_point startTime = chrono::steady_clock::now();
+    for (int imgIndex = 0; imgIndex <= imgEndIndex - imgStartIndex; ++imgIndex)
+    {
+        ostringstream imgNumber;
+        imgNumber << setfill('0') << setw(imgFillWidth) << imgStartIndex + imgIndex;
+        cv::Mat img = cv::imread(imgBasePath + imgPrefix + imgNumber.str() + imgFileType);
+        lidarPoints.clear();
+        if (!loadLidarFromFile(lidarPoints, imgBasePath + lidarPrefix + imgNumber.str() + lidarFileType))
+        {
+            return 1;
+        }
+
+        // both sensors are triggered together at the nominal rate
+        double timestamp = (imgStartIndex + imgIndex) / sensorRate;
+        this_thread::sleep_until(startTime + chrono::duration_cast<chrono::steady_clock::duration>(chrono::duration<double>(imgIndex / sensorRate)));
+
+        PublishResult result = publisher.publishLidar(timestamp, lidarPoints);
+        if (result == PublishResult::FAILED)
+        {
+            cerr << "Sensor stream receiver has disconnected" << endl;
+            return 1;
+        }
+        if (result == PublishResult::DROPPED)
+        {
+            ++nDroppedScans;
+        }
+        result = publisher.publishCamera(timestamp, img);
+        if (result == PublishResult::FAILED)
+        {
+            cerr << "Unable to publish image of frame " << imgIndex << " (receiver disconnected or image too large)" << endl;
+            return 1;
+        }
+        if (result == PublishResult::DROPPED)
+        {
+            ++nDroppedImages;
+        }
+        cout << "published frame " << imgIndex << " (t = " << timestamp << " s, " << lidarPoints.size() << " Lidar points)" << endl;
+    }
+    publisher.close();
+
+    cout << "dropped because the receiver was behind : " << nDroppedImages << " images, " << nDroppedScans << " Lidar scans" << endl;
+    return 0;
+}
@@ -1,6 +1,8 @@
 
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <cstdint>
 #include <opencv2/highgui/highgui.hpp>
 #include <opencv2/imgproc/imgproc.hpp>
 #include "lidarData.hpp"
@@ -11,45 +13,127 @@ using namespace std;
 // remove Lidar points based on min. and max distance in X, Y and Z
 void cropLidarPoints(std::vector<LidarPoint> &lidarPoints, float minX, float maxX, float maxY, float minZ, float maxZ, float minR)
 {
-    std::vector<LidarPoint> newLidarPts; 
+    // compact remaining points in place so that the vector keeps its capacity
+    auto itKeep = lidarPoints.begin();
     for(auto it=lidarPoints.begin(); it!=lidarPoints.end(); ++it) {
         
        if( (*it).x>=minX && (*it).x<=maxX && (*it).z>=minZ && (*it).z<=maxZ && (*it).z<=0.0 && abs((*it).y)<=maxY && (*it).r>=minR )  // Check if Lidar point is outside of boundaries
        {
-           newLidarPts.push_back(*it);
+           *itKeep++ = *it;
        }
     }
 
-    lidarPoints = newLidarPts;
+    lidarPoints.erase(itKeep, lidarPoints.end());
 }
 
 
 
-// Load Lidar points from a given location and store them in a vector
-void loadLidarFromFile(vector<LidarPoint> &lidarPoints, string filename)
+// reduce the point cloud to one point per occupied cube of size leafSize (voxel grid); within each voxel the point
+// with the highest reflectivity is kept as it is the most reliable return. Surviving points keep their original order.
+void downsampleLidarPoints(std::vector<LidarPoint> &lidarPoints, float leafSize)
 {
-    // allocate 4 MB buffer (only ~130*4*4 KB are needed)
-    unsigned long num = 1000000;
-    float *data = (float*)malloc(num*sizeof(float));
-    
-    // pointers
-    float *px = data+0;
-    float *py = data+1;
-    float *pz = data+2;
-    float *pr = data+3;
-    
+    if (lidarPoints.empty() || leafSize <= 0.0)
+    {
+        return;
+    }
+
+    // open-addressing hash table from voxel key to index of the selected point, sized to a load factor <= 0.5
+    struct VoxelEntry {
+        uint64_t key;
+        int pointIdx; // -1 marks an empty slot
+    };
+    static thread_local vector<VoxelEntry> table;
+    static thread_local vector<size_t> pointSlot; // table slot of the voxel each point falls into
+    size_t tableSize = 1;
+    while (tableSize < 2 * lidarPoints.size())
+    {
+        tableSize <<= 1;
+    }
+    VoxelEntry emptyEntry = {0, -1};
+    table.assign(tableSize, emptyEntry);
+    pointSlot.resize(lidarPoints.size());
+
+    double invLeafSize = 1.0 / leafSize;
+    for (size_t i = 0; i < lidarPoints.size(); ++i)
+    {
+        const LidarPoint &lpt = lidarPoints[i];
+
+        // pack integer voxel coordinates (21 bits each) into a single key
+        uint64_t ix = (uint64_t)((int64_t)floor(lpt.x * invLeafSize) + (1 << 20)) & 0x1FFFFF;
+        uint64_t iy = (uint64_t)((int64_t)floor(lpt.y * invLeafSize) + (1 << 20)) & 0x1FFFFF;
+        uint64_t iz = (uint64_t)((int64_t)floor(lpt.z * invLeafSize) + (1 << 20)) & 0x1FFFFF;
+        uint64_t key = (ix << 42) | (iy << 21) | iz;
+
+        // linear probing starting at a multiplicative hash of the key
+        size_t slot = (size_t)((key * 0x9E3779B97F4A7C15ULL) >> 32) & (tableSize - 1);
+        while (table[slot].pointIdx >= 0 && table[slot].key != key)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+
+        if (table[slot].pointIdx < 0)
+        {
+            table[slot].key = key;
+            table[slot].pointIdx = (int)i;
+        }
+        else if (lpt.r > lidarPoints[table[slot].pointIdx].r)
+        {
+            table[slot].pointIdx = (int)i;
+        }
+        pointSlot[i] = slot;
+    }
+
+    // compact selected points in place
+    size_t nKeep = 0;
+    for (size_t i = 0; i < lidarPoints.size(); ++i)
+    {
+        if (table[pointSlot[i]].pointIdx == (int)i)
+        {
+            lidarPoints[nKeep++] = lidarPoints[i];
+        }
+    }
+    lidarPoints.resize(nKeep);
+}
+
+
+
+// Load Lidar points from a given location and append them to a vector
+bool loadLidarFromFile(vector<LidarPoint> &lidarPoints, const string &filename)
+{
+    // read file in chunks through a fixed stack buffer (4 floats per point) instead of a heap buffer
+    const size_t chunkSize = 1024;
+    float data[4 * chunkSize];
+
     // load point cloud
     FILE *stream;
     stream = fopen (filename.c_str(),"rb");
-    num = fread(data,sizeof(float),num,stream)/4;
- 
-    for (int32_t i=0; i<num; i++) {
-        LidarPoint lpt;
-        lpt.x = *px; lpt.y = *py; lpt.z = *pz; lpt.r = *pr;
-        lidarPoints.push_back(lpt);
-        px+=4; py+=4; pz+=4; pr+=4;
+    if (stream == nullptr)
+    {
+        cerr << "Unable to open Lidar file " << filename << endl;
+        return false;
     }
+
+    size_t num;
+    while ((num = fread(data, sizeof(float), 4 * chunkSize, stream) / 4) > 0) {
+
+        float *px = data+0;
+        float *py = data+1;
+        float *pz = data+2;
+        float *pr = data+3;
+        for (size_t i=0; i<num; i++) {
+            LidarPoint lpt;
+            lpt.x = *px; lpt.y = *py; lpt.z = *pz; lpt.r = *pr;
+            lidarPoints.push_back(lpt);
+            px+=4; py+=4; pz+=4; pr+=4;
+        }
+    }
+    bool bOk = !ferror(stream);
     fclose(stream);
+    if (!bOk)
+    {
+        cerr << "Unable to read Lidar file " << filename << endl;
+    }
+    return bOk;
 }
 
 
@@ -89,8 +173,42 @@ void showLidarTopview(std::vector<LidarPoint> &lidarPoints, cv::Size worldSize,
     }
 }
 
+// project Lidar points into the camera image; each projection holds the pixel coordinates (u, v) and the depth along the
+// optical axis, in the same order as the points, so that all later stages can re-use it instead of projecting again
+void projectLidarPoints(const std::vector<LidarPoint> &lidarPoints, std::vector<cv::Point3f> &lidarProjections, const cv::Mat &P_rect_xx, const cv::Mat &R_rect_xx, const cv::Mat &RT)
+{
+    // combine projection, rectification and extrinsic calibration once instead of per point
+    cv::Mat P = P_rect_xx * R_rect_xx * RT;
+    const double *p = P.ptr<double>(0);
+
+    lidarProjections.resize(lidarPoints.size());
+    for (size_t i = 0; i < lidarPoints.size(); ++i)
+    {
+        const LidarPoint &lpt = lidarPoints[i];
+        double u = p[0] * lpt.x + p[1] * lpt.y + p[2] * lpt.z + p[3];
+        double v = p[4] * lpt.x + p[5] * lpt.y + p[6] * lpt.z + p[7];
+        double w = p[8] * lpt.x + p[9] * lpt.y + p[10] * lpt.z + p[11];
+        lidarProjections[i] = cv::Point3f(u / w, v / w, w);
+    }
+}
+
 void showLidarImgOverlay(cv::Mat &img, std::vector<LidarPoint> &lidarPoints, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT, cv::Mat *extVisImg)
 {
+    vector<cv::Point3f> lidarProjections;
+    projectLidarPoints(lidarPoints, lidarProjections, P_rect_xx, R_rect_xx, RT);
+
+    IndexSpan allPoints;
+    allPoints.size = (int)lidarPoints.size();
+    showLidarImgOverlay(img, lidarPoints, lidarProjections, allPoints, extVisImg);
+}
+
+// overlay a range of a Lidar point cloud (e.g. the points of a single bounding box) onto the camera image using the
+// cached image projections of the points
+void showLidarImgOverlay(cv::Mat &img, const std::vector<LidarPoint> &lidarPoints, const std::vector<cv::Point3f> &lidarProjections, IndexSpan span, cv::Mat *extVisImg)
+{
+    auto itBegin = lidarPoints.begin() + span.begin;
+    auto itEnd = itBegin + span.size;
+
     // init image for visualization
     cv::Mat visImg; 
     if(extVisImg==nullptr)
@@ -105,24 +223,17 @@ void showLidarImgOverlay(cv::Mat &img, std::vector<LidarPoint> &lidarPoints, cv:
 
     // find max. x-value
     double maxVal = 0.0; 
-    for(auto it=lidarPoints.begin(); it!=lidarPoints.end(); ++it)
+    for(auto it=itBegin; it!=itEnd; ++it)
     {
         maxVal = maxVal<it->x ? it->x : maxVal;
     }
 
-    cv::Mat X(4,1,cv::DataType<double>::type);
-    cv::Mat Y(3,1,cv::DataType<double>::type);
-    for(auto it=lidarPoints.begin(); it!=lidarPoints.end(); ++it) {
-
-            X.at<double>(0, 0) = it->x;
-            X.at<double>(1, 0) = it->y;
-            X.at<double>(2, 0) = it->z;
-            X.at<double>(3, 0) = 1;
+    auto itProj = lidarProjections.begin() + span.begin;
+    for(auto it=itBegin; it!=itEnd; ++it, ++itProj) {
 
-            Y = P_rect_xx * R_rect_xx * RT * X;
             cv::Point pt;
-            pt.x = Y.at<double>(0, 0) / Y.at<double>(0, 2);
-            pt.y = Y.at<double>(1, 0) / Y.at<double>(0, 2);
+            pt.x = itProj->x;
+            pt.y = itProj->y;
 
             float val = it->x;
             int red = min(255, (int)(255 * abs((val - maxVal) / maxVal)));
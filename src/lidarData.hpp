@@ -9,8 +9,11 @@
 #include "dataStructures.h"
 
 void cropLidarPoints(std::vector<LidarPoint> &lidarPoints, float minX, float maxX, float maxY, float minZ, float maxZ, float minR);
-void loadLidarFromFile(std::vector<LidarPoint> &lidarPoints, std::string filename);
+void downsampleLidarPoints(std::vector<LidarPoint> &lidarPoints, float leafSize);
+void projectLidarPoints(const std::vector<LidarPoint> &lidarPoints, std::vector<cv::Point3f> &lidarProjections, const cv::Mat &P_rect_xx, const cv::Mat &R_rect_xx, const cv::Mat &RT);
+bool loadLidarFromFile(std::vector<LidarPoint> &lidarPoints, const std::string &filename); // false if the file cannot be read
 
 void showLidarTopview(std::vector<LidarPoint> &lidarPoints, cv::Size worldSize, cv::Size imageSize, bool bWait=true);
 void showLidarImgOverlay(cv::Mat &img, std::vector<LidarPoint> &lidarPoints, cv::Mat &P_rect_xx, cv::Mat &R_rect_xx, cv::Mat &RT, cv::Mat *extVisImg=nullptr);
+void showLidarImgOverlay(cv::Mat &img, const std::vector<LidarPoint> &lidarPoints, const std::vector<cv::Point3f> &lidarProjections, IndexSpan span, cv::Mat *extVisImg=nullptr);
 #endif /* lidarData_hpp */
@@ -2,6 +2,7 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <cassert>
 
 #include <opencv2/dnn.hpp>
 #include <opencv2/imgproc.hpp>
@@ -12,22 +13,76 @@
 
 using namespace std;
 
-// detects objects in an image using the YOLO library and a set of pre-trained objects from the COCO database;
-// a set of 80 classes is listed in "coco.names" and pre-trained weights are stored in "yolov3.weights"
-void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThreshold, float nmsThreshold, 
-                   std::string basePath, std::string classesFile, std::string modelConfiguration, std::string modelWeights, bool bVis)
+// loads class names and network once, so that the (expensive) model setup is not repeated for every frame
+ObjectDetector::ObjectDetector(std::string classesFile, std::string modelConfiguration, std::string modelWeights)
 {
     // load class names from file
-    vector<string> classes;
     ifstream ifs(classesFile.c_str());
     string line;
     while (getline(ifs, line)) classes.push_back(line);
     
     // load neural network
-    cv::dnn::Net net = cv::dnn::readNetFromDarknet(modelConfiguration, modelWeights);
+    net = cv::dnn::readNetFromDarknet(modelConfiguration, modelWeights);
+    init();
+}
+
+ObjectDetector::ObjectDetector(const YoloModelData &model) : classes(model.classes)
+{
+    // each detector owns its network (forward passes modify layer buffers), only the file contents are shared
+    net = cv::dnn::readNetFromDarknet(model.configuration, model.weights);
+    init();
+}
+
+void ObjectDetector::init()
+{
     net.setPreferableBackend(cv::dnn::DNN_BACKEND_OPENCV);
     net.setPreferableTarget(cv::dnn::DNN_TARGET_CPU);
+
+    // Get names of output layers
+    vector<int> outLayers = net.getUnconnectedOutLayers(); // get  indices of  output layers, i.e.  layers with unconnected outputs
+    vector<cv::String> layersNames = net.getLayerNames(); // get  names of all layers in the network
     
+    outLayerNames.resize(outLayers.size());
+    for (size_t i = 0; i < outLayers.size(); ++i) // Get the names of the output layers in names
+        outLayerNames[i] = layersNames[outLayers[i] - 1];
+}
+
+static bool readBinaryFile(const std::string &filename, std::vector<unsigned char> &data)
+{
+    ifstream ifs(filename.c_str(), ios::binary);
+    if (!ifs)
+    {
+        cerr << "Unable to open model file " << filename << endl;
+        return false;
+    }
+    ifs.seekg(0, ios::end);
+    data.resize((size_t)ifs.tellg());
+    ifs.seekg(0, ios::beg);
+    return ifs.read((char *)data.data(), data.size()).good() || data.empty();
+}
+
+bool loadYoloModelData(std::string classesFile, std::string modelConfiguration, std::string modelWeights, YoloModelData &model)
+{
+    // load class names from file
+    model.classes.clear();
+    ifstream ifs(classesFile.c_str());
+    string line;
+    while (getline(ifs, line)) model.classes.push_back(line);
+
+    return readBinaryFile(modelConfiguration, model.configuration) && readBinaryFile(modelWeights, model.weights);
+}
+
+// detects objects in an image using the YOLO library and a set of pre-trained objects from the COCO database;
+// a set of 80 classes is listed in "coco.names" and pre-trained weights are stored in "yolov3.weights"
+void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThreshold, float nmsThreshold, 
+                   std::string basePath, std::string classesFile, std::string modelConfiguration, std::string modelWeights, bool bVis)
+{
+    ObjectDetector detector(classesFile, modelConfiguration, modelWeights);
+    detector.detect(img, bBoxes, confThreshold, nmsThreshold, bVis);
+}
+
+void ObjectDetector::detect(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThreshold, float nmsThreshold, bool bVis)
+{
     // generate 4D blob from input image
     cv::Mat blob;
     vector<cv::Mat> netOutput;
@@ -38,18 +93,9 @@ void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThr
     bool crop = false;
     cv::dnn::blobFromImage(img, blob, scalefactor, size, mean, swapRB, crop);
     
-    // Get names of output layers
-    vector<cv::String> names;
-    vector<int> outLayers = net.getUnconnectedOutLayers(); // get  indices of  output layers, i.e.  layers with unconnected outputs
-    vector<cv::String> layersNames = net.getLayerNames(); // get  names of all layers in the network
-    
-    names.resize(outLayers.size());
-    for (size_t i = 0; i < outLayers.size(); ++i) // Get the names of the output layers in names
-        names[i] = layersNames[outLayers[i] - 1];
-    
     // invoke forward propagation through network
     net.setInput(blob);
-    net.forward(netOutput, names);
+    net.forward(netOutput, outLayerNames);
     
     // Scan through all bounding boxes and keep only the ones with high confidence
     vector<int> classIds; vector<float> confidences; vector<cv::Rect> boxes;
@@ -84,6 +130,9 @@ void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThr
     // perform non-maxima suppression
     vector<int> indices;
     cv::dnn::NMSBoxes(boxes, confidences, confThreshold, nmsThreshold, indices);
+
+    // later stages use boxID to index the box list, so new boxes continue the numbering of those already in the list
+    assert(bBoxes.empty() || bBoxes.back().boxID == (int)bBoxes.size() - 1);
     for(auto it=indices.begin(); it!=indices.end(); ++it) {
         
         BoundingBox bBox;
@@ -3,11 +3,41 @@
 #define objectDetection2D_hpp
 
 #include <stdio.h>
+#include <vector>
+#include <string>
 #include <opencv2/core.hpp>
+#include <opencv2/dnn.hpp>
 
 #include "dataStructures.h"
 
 void detectObjects(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThreshold, float nmsThreshold, 
                    std::string basePath, std::string classesFile, std::string modelConfiguration, std::string modelWeights, bool bVis);
 
+// YOLO model files read into memory once, e.g. to build detectors for several worker threads without reading the
+// weights from disk again; only read after loading
+struct YoloModelData {
+    std::vector<std::string> classes;
+    std::vector<unsigned char> configuration; // contents of the .cfg file
+    std::vector<unsigned char> weights; // contents of the .weights file
+};
+
+bool loadYoloModelData(std::string classesFile, std::string modelConfiguration, std::string modelWeights, YoloModelData &model);
+
+// YOLO detector which keeps the network loaded across frames
+class ObjectDetector
+{
+public:
+    ObjectDetector(std::string classesFile, std::string modelConfiguration, std::string modelWeights);
+    ObjectDetector(const YoloModelData &model); // network is parsed from the in-memory model, which is not modified
+
+    void detect(cv::Mat& img, std::vector<BoundingBox>& bBoxes, float confThreshold, float nmsThreshold, bool bVis);
+
+private:
+    void init(); // configure the loaded network
+
+    std::vector<std::string> classes;
+    cv::dnn::Net net;
+    std::vector<cv::String> outLayerNames;
+};
+
 #endif /* objectDetection2D_hpp */
@@ -0,0 +1,97 @@
+#include <thread>
+#include <algorithm>
+
+#include "realTimeScheduler.hpp"
+
+using namespace std;
+
+RealTimeScheduler::RealTimeScheduler(const RealTimeConfig &config)
+    : config(config), qualityLevel(QualityLevel::FULL), frameLevel(QualityLevel::FULL), nSkippedDetections(0), nDropped(0)
+{
+    fill(levelCost, levelCost + 4, 0.0);
+}
+
+void RealTimeScheduler::start()
+{
+    startTime = Clock::now();
+    currentArrival = startTime;
+    processingStart = startTime;
+    nDropped = 0;
+}
+
+RealTimeScheduler::Clock::time_point RealTimeScheduler::arrivalTime(size_t index) const
+{
+    return startTime + chrono::duration_cast<Clock::duration>(chrono::duration<double>(index / config.sensorRate));
+}
+
+size_t RealTimeScheduler::waitForFrame(size_t index, size_t stepWidth, size_t lastIndex)
+{
+    Clock::time_point now = Clock::now();
+    if (now < arrivalTime(index))
+    {
+        // ahead of the sensor : idle until the frame is there
+        this_thread::sleep_until(arrivalTime(index));
+        currentArrival = arrivalTime(index);
+        processingStart = Clock::now();
+        return index;
+    }
+
+    // behind the sensor : skip to the newest frame which has arrived
+    size_t newest = (size_t)(chrono::duration<double>(now - startTime).count() * config.sensorRate);
+    newest = min(newest - newest % stepWidth, lastIndex - lastIndex % stepWidth);
+    newest = max(newest, index);
+
+    nDropped += (newest - index) / stepWidth;
+    currentArrival = arrivalTime(newest);
+    processingStart = now;
+    return newest;
+}
+
+double RealTimeScheduler::frameDone()
+{
+    Clock::time_point now = Clock::now();
+    double latency = chrono::duration<double>(now - currentArrival).count();
+
+    // processing time of the level the frame actually ran at
+    int frameLevelIdx = (int)frameLevel;
+    double cost = chrono::duration<double>(now - processingStart).count();
+    levelCost[frameLevelIdx] = levelCost[frameLevelIdx] > 0.0 ? 0.5 * (levelCost[frameLevelIdx] + cost) : cost;
+    nSkippedDetections = frameLevel == QualityLevel::SKIP_DETECTION ? nSkippedDetections + 1 : 0;
+
+    // one level per frame in either direction, so that a single spike does not switch off all expensive stages
+    int level = (int)qualityLevel;
+    if (frameLevelIdx < level && latency <= config.deadline)
+    {
+        // a forced detection fitted into the deadline, so its level is affordable again
+        level = frameLevelIdx;
+    }
+    else if (latency > config.deadline)
+    {
+        level = min(level + 1, (int)QualityLevel::SKIP_DETECTION);
+    }
+    else if (level > (int)QualityLevel::FULL)
+    {
+        // the higher level adds the difference in processing time to the latency measured at the current level
+        bool bCostsKnown = levelCost[level - 1] > 0.0 && levelCost[level] > 0.0;
+        double extraCost = bCostsKnown ? max(0.0, levelCost[level - 1] - levelCost[level]) : 0.0;
+        bool bRecover = bCostsKnown ? latency + extraCost < config.deadline : latency < config.recoverFraction * config.deadline;
+        level = bRecover ? level - 1 : level;
+    }
+    qualityLevel = (QualityLevel)level;
+
+    // boxes must not be re-used for more than maxSkippedDetections frames in a row
+    bool bForceDetection = qualityLevel == QualityLevel::SKIP_DETECTION && nSkippedDetections >= config.maxSkippedDetections;
+    frameLevel = bForceDetection ? QualityLevel::LIGHT_DETECTOR : qualityLevel;
+
+    return latency;
+}
+
+QualityLevel RealTimeScheduler::getQualityLevel() const
+{
+    return frameLevel;
+}
+
+size_t RealTimeScheduler::droppedFrames() const
+{
+    return nDropped;
+}
@@ -0,0 +1,57 @@
+
+#ifndef realTimeScheduler_hpp
+#define realTimeScheduler_hpp
+
+#include <stdio.h>
+#include <chrono>
+
+// work which is done for a frame, each level drops more of it to catch up with the sensor
+enum class QualityLevel { FULL, REDUCED_KEYPOINTS, LIGHT_DETECTOR, SKIP_DETECTION };
+
+struct RealTimeConfig {
+
+    double sensorRate;      // rate at which the sensors deliver frames in [Hz], i.e. playback rate of the sequence
+    double deadline;        // max. latency between arrival of a frame and the end of its processing in [s]
+    double recoverFraction; // step back to a higher quality level when the latency was below this fraction of the deadline
+                            // (only used as long as the extra work of the higher level has not been measured)
+    int maxSkippedDetections; // max. no. of consecutive frames which re-use the boxes of the previous frame
+};
+
+// plays a recorded sequence at sensor rate : frames which arrive while the pipeline is busy are dropped in favor of the
+// newest one, and the quality level is adapted to the latency of the previous frame; at level SKIP_DETECTION every
+// (maxSkippedDetections + 1)-th frame still runs the light detector, which refreshes the boxes and probes whether that
+// level fits into the deadline again
+class RealTimeScheduler
+{
+public:
+    RealTimeScheduler(const RealTimeConfig &config);
+
+    void start(); // the first frame of the sequence arrives now, to be called once right before processing it
+
+    // wait until the frame with the given index has arrived; if newer frames (on the grid of stepWidth, up to lastIndex)
+    // have arrived already, the newest of them is returned instead
+    size_t waitForFrame(size_t index, size_t stepWidth, size_t lastIndex);
+
+    // latency of the current frame, adapts the quality level for the next one
+    double frameDone();
+
+    QualityLevel getQualityLevel() const; // level at which the next frame is to be processed
+    size_t droppedFrames() const;
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    Clock::time_point arrivalTime(size_t index) const;
+
+    RealTimeConfig config;
+    Clock::time_point startTime;
+    Clock::time_point currentArrival; // arrival time of the frame which is being processed
+    Clock::time_point processingStart; // time at which processing of the current frame started
+    QualityLevel qualityLevel; // level adapted to the latency
+    QualityLevel frameLevel;   // level of the current frame, differs from qualityLevel for forced detections
+    int nSkippedDetections;    // no. of consecutive frames processed at SKIP_DETECTION
+    double levelCost[4];       // smoothed processing time of a frame at each quality level in [s], 0 if not measured yet
+    size_t nDropped;
+};
+
+#endif /* realTimeScheduler_hpp */
@@ -0,0 +1,415 @@
+#include <iostream>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "recording.hpp"
+
+using namespace std;
+
+static_assert(sizeof(RecordingHeader) % 8 == 0, "recording records must keep 8-byte alignment");
+static_assert(sizeof(FrameRecordHeader) % 8 == 0, "recording records must keep 8-byte alignment");
+static_assert(sizeof(BoxRecord) % 8 == 0, "recording records must keep 8-byte alignment");
+static_assert(sizeof(LidarPoint) % 8 == 0, "recording records must keep 8-byte alignment");
+static_assert(sizeof(KeypointRecord) % 8 == 0, "recording records must keep 8-byte alignment");
+static_assert(sizeof(MatchRecord) % 8 == 0, "recording records must keep 8-byte alignment");
+static_assert(sizeof(BoxMatchRecord) % 8 == 0, "recording records must keep 8-byte alignment");
+static_assert(sizeof(TTCResult) % 8 == 0, "recording records must keep 8-byte alignment");
+
+static const char recordingMagic[8] = "SFNDREC";
+static const uint32_t recordingVersion = 2;
+
+static size_t alignTo8(size_t n)
+{
+    return (n + 7) & ~(size_t)7;
+}
+
+static const uint64_t fnvOffsetBasis = 14695981039346656037ULL;
+
+static uint64_t fnv1a(uint64_t hash, const void *data, size_t nBytes)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    for (size_t i = 0; i < nBytes; ++i)
+    {
+        hash = (hash ^ bytes[i]) * 1099511628211ULL;
+    }
+    return hash;
+}
+
+uint64_t hashLidarPoints(const std::vector<LidarPoint> &lidarPoints)
+{
+    return lidarPoints.empty() ? fnvOffsetBasis : fnv1a(fnvOffsetBasis, lidarPoints.data(), lidarPoints.size() * sizeof(LidarPoint));
+}
+
+uint64_t hashKptMatches(const std::vector<cv::DMatch> &kptMatches)
+{
+    // hashed field by field as stored in MatchRecord, independent of the layout of cv::DMatch
+    uint64_t hash = fnvOffsetBasis;
+    for (auto it = kptMatches.begin(); it != kptMatches.end(); ++it)
+    {
+        MatchRecord match = {it->queryIdx, it->trainIdx, it->imgIdx, it->distance};
+        hash = fnv1a(hash, &match, sizeof(match));
+    }
+    return hash;
+}
+
+// no. of bytes of a frame record including all arrays, as laid out by RecordingWriter::writeFrame
+static uint64_t frameRecordSize(const FrameRecordHeader &frameHeader)
+{
+    return sizeof(FrameRecordHeader) + (uint64_t)frameHeader.nBoxes * sizeof(BoxRecord) + (uint64_t)frameHeader.nLidarPoints * sizeof(LidarPoint)
+           + (uint64_t)frameHeader.nKeypoints * sizeof(KeypointRecord) + alignTo8((uint64_t)frameHeader.descRows * frameHeader.descRowBytes)
+           + (uint64_t)frameHeader.nKptMatches * sizeof(MatchRecord) + (uint64_t)frameHeader.nBBMatches * sizeof(BoxMatchRecord)
+           + (uint64_t)frameHeader.nTTCResults * sizeof(TTCResult);
+}
+
+// true if [begin, begin + size) lies within an array of n elements
+static bool validRange(int32_t begin, int32_t size, uint32_t n)
+{
+    return begin >= 0 && size >= 0 && (int64_t)begin + size <= (int64_t)n;
+}
+
+static bool validIndex(int32_t idx, uint32_t n)
+{
+    return idx >= 0 && (uint32_t)idx < n;
+}
+
+// every index stored in a frame record has to refer to an entry of the frame itself or of the previous frame (prev is
+// nullptr for the first frame, which cannot hold matches), as the replayed stages use them without further checks
+static bool validFrameIndices(const RecordedFrame &rec, const RecordedFrame *prev)
+{
+    const FrameRecordHeader &frameHeader = *rec.header;
+    uint32_t nPrevKeypoints = prev != nullptr ? prev->header->nKeypoints : 0;
+    uint32_t nPrevBoxes = prev != nullptr ? prev->header->nBoxes : 0;
+    bool bValid = frameHeader.descRows == frameHeader.nKeypoints;
+
+    // boxes are indexed by boxID, their ranges refer to the Lidar points and keypoint matches of the frame
+    for (size_t j = 0; bValid && j < frameHeader.nBoxes; ++j)
+    {
+        const BoxRecord &box = rec.boxes[j];
+        bValid = box.boxID == (int32_t)j && validRange(box.lidarBegin, box.lidarSize, frameHeader.nLidarPoints) &&
+                 validRange(box.matchBegin, box.matchSize, frameHeader.nKptMatches);
+    }
+    for (size_t j = 0; bValid && j < frameHeader.nKptMatches; ++j)
+    {
+        bValid = validIndex(rec.kptMatches[j].queryIdx, nPrevKeypoints) && validIndex(rec.kptMatches[j].trainIdx, frameHeader.nKeypoints);
+    }
+    for (size_t j = 0; bValid && j < frameHeader.nBBMatches; ++j)
+    {
+        bValid = validIndex(rec.bbMatches[j].prevBoxID, nPrevBoxes) && validIndex(rec.bbMatches[j].currBoxID, frameHeader.nBoxes);
+    }
+    for (size_t j = 0; bValid && j < frameHeader.nTTCResults; ++j)
+    {
+        bValid = validIndex(rec.ttcResults[j].prevBoxID, nPrevBoxes) && validIndex(rec.ttcResults[j].boxID, frameHeader.nBoxes);
+    }
+    return bValid;
+}
+
+RecordingWriter::RecordingWriter() : stream(nullptr), offset(0)
+{
+}
+
+RecordingWriter::~RecordingWriter()
+{
+    close();
+}
+
+bool RecordingWriter::open(const std::string &filename, const cv::Mat &P_rect_xx, const cv::Mat &R_rect_xx, const cv::Mat &RT,
+                           float shrinkFactor, float clusterTolerance, bool bFilterClusters)
+{
+    stream = fopen(filename.c_str(), "wb");
+    if (stream == nullptr)
+    {
+        cerr << "Unable to create recording " << filename << endl;
+        return false;
+    }
+
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, recordingMagic, sizeof(header.magic));
+    header.version = recordingVersion;
+    for (int i = 0; i < 12; ++i)
+    {
+        header.P_rect[i] = P_rect_xx.at<double>(i / 4, i % 4);
+    }
+    for (int i = 0; i < 16; ++i)
+    {
+        header.R_rect[i] = R_rect_xx.at<double>(i / 4, i % 4);
+        header.RT[i] = RT.at<double>(i / 4, i % 4);
+    }
+    header.shrinkFactor = shrinkFactor;
+    header.clusterTolerance = clusterTolerance;
+    header.bFilterClusters = bFilterClusters ? 1 : 0;
+
+    // header is written again with the final frame count on close
+    frameOffsets.clear();
+    offset = 0;
+    writePadded(&header, sizeof(header));
+    return true;
+}
+
+void RecordingWriter::writePadded(const void *data, size_t nBytes)
+{
+    static const char zeros[8] = {0};
+    fwrite(data, 1, nBytes, stream);
+    fwrite(zeros, 1, alignTo8(nBytes) - nBytes, stream);
+    offset += alignTo8(nBytes);
+}
+
+void RecordingWriter::writeFrame(int frameIndex, double frameRate, const DataFrame &frame, const std::vector<LidarPoint> &lidarPointsIn,
+                                 const std::vector<cv::DMatch> &kptMatchesIn)
+{
+    if (stream == nullptr)
+    {
+        return;
+    }
+    frameOffsets.push_back(offset);
+
+    FrameRecordHeader frameHeader;
+    memset(&frameHeader, 0, sizeof(frameHeader));
+    frameHeader.frameIndex = frameIndex;
+    frameHeader.nBoxes = frame.boundingBoxes.size();
+    frameHeader.nLidarPoints = lidarPointsIn.size();
+    frameHeader.nKeypoints = frame.keypoints.size();
+    frameHeader.descRows = frame.descriptors.rows;
+    frameHeader.descCols = frame.descriptors.cols;
+    frameHeader.descType = frame.descriptors.type();
+    frameHeader.descRowBytes = frame.descriptors.cols * frame.descriptors.elemSize();
+    frameHeader.nKptMatches = kptMatchesIn.size();
+    frameHeader.nBBMatches = frame.bbMatches.size();
+    frameHeader.nTTCResults = frame.ttcResults.size();
+    frameHeader.frameRate = frameRate;
+    frameHeader.lidarPointsHash = hashLidarPoints(frame.lidarPoints);
+    frameHeader.kptMatchesHash = hashKptMatches(frame.kptMatches);
+    writePadded(&frameHeader, sizeof(frameHeader));
+
+    for (auto it = frame.boundingBoxes.begin(); it != frame.boundingBoxes.end(); ++it)
+    {
+        BoxRecord box = {it->boxID, it->trackID, it->classID, it->roi.x, it->roi.y, it->roi.width, it->roi.height, (float)it->confidence,
+                         it->lidarPoints.begin, it->lidarPoints.size, it->kptMatches.begin, it->kptMatches.size};
+        writePadded(&box, sizeof(box));
+    }
+
+    if (!lidarPointsIn.empty())
+    {
+        writePadded(lidarPointsIn.data(), lidarPointsIn.size() * sizeof(LidarPoint));
+    }
+
+    for (auto it = frame.keypoints.begin(); it != frame.keypoints.end(); ++it)
+    {
+        KeypointRecord kpt = {it->pt.x, it->pt.y, it->size, it->angle, it->response, it->octave, it->class_id, 0};
+        writePadded(&kpt, sizeof(kpt));
+    }
+
+    // descriptor rows are written back to back (the matrix itself may have padded rows)
+    if (frameHeader.descRows * frameHeader.descRowBytes > 0)
+    {
+        static const char zeros[8] = {0};
+        size_t nDescBytes = (size_t)frameHeader.descRows * frameHeader.descRowBytes;
+        for (int r = 0; r < frame.descriptors.rows; ++r)
+        {
+            fwrite(frame.descriptors.ptr(r), 1, frameHeader.descRowBytes, stream);
+        }
+        fwrite(zeros, 1, alignTo8(nDescBytes) - nDescBytes, stream);
+        offset += alignTo8(nDescBytes);
+    }
+
+    for (auto it = kptMatchesIn.begin(); it != kptMatchesIn.end(); ++it)
+    {
+        MatchRecord match = {it->queryIdx, it->trainIdx, it->imgIdx, it->distance};
+        writePadded(&match, sizeof(match));
+    }
+
+    for (auto it = frame.bbMatches.begin(); it != frame.bbMatches.end(); ++it)
+    {
+        BoxMatchRecord bbMatch = {it->first, it->second};
+        writePadded(&bbMatch, sizeof(bbMatch));
+    }
+
+    if (!frame.ttcResults.empty())
+    {
+        writePadded(frame.ttcResults.data(), frame.ttcResults.size() * sizeof(TTCResult));
+    }
+}
+
+void RecordingWriter::close()
+{
+    if (stream == nullptr)
+    {
+        return;
+    }
+
+    // append frame table and patch header
+    header.nFrames = frameOffsets.size();
+    header.frameTableOffset = offset;
+    if (!frameOffsets.empty())
+    {
+        fwrite(frameOffsets.data(), sizeof(uint64_t), frameOffsets.size(), stream);
+    }
+    fseek(stream, 0, SEEK_SET);
+    fwrite(&header, sizeof(header), 1, stream);
+
+    fclose(stream);
+    stream = nullptr;
+}
+
+
+RecordingReader::RecordingReader() : data(nullptr), nBytes(0), frameTable(nullptr)
+{
+}
+
+RecordingReader::~RecordingReader()
+{
+    if (data != nullptr)
+    {
+        munmap((void *)data, nBytes);
+    }
+}
+
+bool RecordingReader::open(const std::string &filename)
+{
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        cerr << "Unable to open recording " << filename << endl;
+        return false;
+    }
+
+    struct stat fileStat;
+    fstat(fd, &fileStat);
+    nBytes = fileStat.st_size;
+    void *mapped = nBytes >= sizeof(RecordingHeader) ? mmap(nullptr, nBytes, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+    ::close(fd);
+    if (mapped == MAP_FAILED)
+    {
+        cerr << "Unable to map recording " << filename << endl;
+        nBytes = 0;
+        return false;
+    }
+    data = (const uint8_t *)mapped;
+
+    const RecordingHeader &header = getHeader();
+    bool bValid = memcmp(header.magic, recordingMagic, sizeof(recordingMagic)) == 0 && header.version == recordingVersion &&
+                  header.frameTableOffset >= sizeof(RecordingHeader) && header.frameTableOffset % 8 == 0 &&
+                  header.frameTableOffset <= nBytes && header.nFrames <= (nBytes - header.frameTableOffset) / sizeof(uint64_t);
+    if (bValid)
+    {
+        frameTable = (const uint64_t *)(data + header.frameTableOffset);
+    }
+
+    // frames are stored back to back, so each one has to fit between its own offset and the next frame (or the table)
+    for (size_t i = 0; bValid && i < header.nFrames; ++i)
+    {
+        uint64_t begin = frameTable[i];
+        uint64_t end = i + 1 < header.nFrames ? frameTable[i + 1] : header.frameTableOffset;
+        bValid = begin >= sizeof(RecordingHeader) && begin % 8 == 0 && begin <= end && end <= header.frameTableOffset &&
+                 end - begin >= sizeof(FrameRecordHeader);
+        if (bValid)
+        {
+            const FrameRecordHeader &frameHeader = *(const FrameRecordHeader *)(data + begin);
+            bValid = frameRecordSize(frameHeader) == end - begin && frameHeader.descRowBytes == frameHeader.descCols * CV_ELEM_SIZE(frameHeader.descType);
+        }
+        if (bValid)
+        {
+            // the arrays of this frame and of the previous one (checked in the last iteration) are in bounds now
+            RecordedFrame rec = frame(i);
+            RecordedFrame prev = i > 0 ? frame(i - 1) : rec;
+            bValid = validFrameIndices(rec, i > 0 ? &prev : nullptr);
+        }
+    }
+
+    if (!bValid)
+    {
+        cerr << "Invalid or incomplete recording " << filename << endl;
+        munmap(mapped, nBytes);
+        data = nullptr;
+        nBytes = 0;
+        frameTable = nullptr;
+        return false;
+    }
+    return true;
+}
+
+const RecordingHeader &RecordingReader::getHeader() const
+{
+    return *(const RecordingHeader *)data;
+}
+
+size_t RecordingReader::size() const
+{
+    return data != nullptr ? getHeader().nFrames : 0;
+}
+
+RecordedFrame RecordingReader::frame(size_t i) const
+{
+    RecordedFrame rec;
+    const uint8_t *ptr = data + frameTable[i];
+
+    rec.header = (const FrameRecordHeader *)ptr;
+    ptr += sizeof(FrameRecordHeader);
+    rec.boxes = (const BoxRecord *)ptr;
+    ptr += rec.header->nBoxes * sizeof(BoxRecord);
+    rec.lidarPoints = (const LidarPoint *)ptr;
+    ptr += rec.header->nLidarPoints * sizeof(LidarPoint);
+    rec.keypoints = (const KeypointRecord *)ptr;
+    ptr += rec.header->nKeypoints * sizeof(KeypointRecord);
+    rec.descriptors = ptr;
+    ptr += alignTo8((size_t)rec.header->descRows * rec.header->descRowBytes);
+    rec.kptMatches = (const MatchRecord *)ptr;
+    ptr += rec.header->nKptMatches * sizeof(MatchRecord);
+    rec.bbMatches = (const BoxMatchRecord *)ptr;
+    ptr += rec.header->nBBMatches * sizeof(BoxMatchRecord);
+    rec.ttcResults = (const TTCResult *)ptr;
+    return rec;
+}
+
+void RecordingReader::loadFrame(size_t i, DataFrame &frame) const
+{
+    RecordedFrame rec = this->frame(i);
+
+    frame.boundingBoxes.resize(rec.header->nBoxes);
+    for (size_t j = 0; j < rec.header->nBoxes; ++j)
+    {
+        BoundingBox &box = frame.boundingBoxes[j];
+        box.boxID = rec.boxes[j].boxID;
+        box.trackID = -1;
+        box.roi = cv::Rect(rec.boxes[j].x, rec.boxes[j].y, rec.boxes[j].width, rec.boxes[j].height);
+        box.classID = rec.boxes[j].classID;
+        box.confidence = rec.boxes[j].confidence;
+        box.lidarPoints = IndexSpan();
+        box.kptMatches = IndexSpan();
+    }
+
+    frame.lidarPoints.assign(rec.lidarPoints, rec.lidarPoints + rec.header->nLidarPoints);
+
+    frame.keypoints.resize(rec.header->nKeypoints);
+    for (size_t j = 0; j < rec.header->nKeypoints; ++j)
+    {
+        const KeypointRecord &kpt = rec.keypoints[j];
+        cv::KeyPoint &keypoint = frame.keypoints[j];
+        keypoint.pt = cv::Point2f(kpt.x, kpt.y);
+        keypoint.size = kpt.size;
+        keypoint.angle = kpt.angle;
+        keypoint.response = kpt.response;
+        keypoint.octave = kpt.octave;
+        keypoint.class_id = kpt.classID;
+    }
+
+    // zero-copy view onto the mapped descriptors
+    frame.descriptors = rec.header->descRows > 0 ? cv::Mat(rec.header->descRows, rec.header->descCols, rec.header->descType,
+                                                           (void *)rec.descriptors, rec.header->descRowBytes)
+                                                 : cv::Mat();
+
+    frame.kptMatches.resize(rec.header->nKptMatches);
+    for (size_t j = 0; j < rec.header->nKptMatches; ++j)
+    {
+        cv::DMatch &match = frame.kptMatches[j];
+        match.queryIdx = rec.kptMatches[j].queryIdx;
+        match.trainIdx = rec.kptMatches[j].trainIdx;
+        match.imgIdx = rec.kptMatches[j].imgIdx;
+        match.distance = rec.kptMatches[j].distance;
+    }
+
+    frame.bbMatches.clear();
+    frame.ttcResults.clear();
+}
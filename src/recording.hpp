@@ -0,0 +1,136 @@
+
+#ifndef recording_hpp
+#define recording_hpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+
+// Binary recording of per-frame intermediate results, used to replay single pipeline stages in isolation.
+// All records are plain fixed-size structs in native byte order, and every array starts at an 8-byte boundary,
+// so that a memory-mapped file can be read in place without parsing.
+//
+// layout : RecordingHeader | frame 0 | frame 1 | ... | uint64_t offset of each frame
+// frame  : FrameRecordHeader | BoxRecord[nBoxes] | LidarPoint[nLidarPoints] | KeypointRecord[nKeypoints]
+//          | descriptor data (descRows * descRowBytes) | MatchRecord[nKptMatches] | BoxMatchRecord[nBBMatches]
+//          | TTCResult[nTTCResults]
+
+struct RecordingHeader {
+    char magic[8];          // "SFNDREC"
+    uint32_t version;
+    uint32_t nFrames;
+    uint64_t frameTableOffset; // file offset of the frame offset table
+    double P_rect[12];      // calibration used for clustering (row-major)
+    double R_rect[16];
+    double RT[16];
+    float shrinkFactor;     // parameters of the recorded clustering stages
+    float clusterTolerance;
+    uint32_t bFilterClusters;
+    uint32_t reserved;
+};
+
+struct FrameRecordHeader {
+    int32_t frameIndex;
+    uint32_t nBoxes;
+    uint32_t nLidarPoints;  // Lidar points as passed into clusterLidarWithROI
+    uint32_t nKeypoints;
+    uint32_t descRows, descCols;
+    int32_t descType;       // OpenCV type of the descriptor matrix
+    uint32_t descRowBytes;
+    uint32_t nKptMatches;   // keypoint matches as passed into clusterKptMatchesWithROI
+    uint32_t nBBMatches;
+    uint32_t nTTCResults;
+    uint32_t reserved;
+    double frameRate;       // rate passed to the TTC estimators, i.e. 1 / time between previous and current frame
+    uint64_t lidarPointsHash; // hashes of the Lidar points and keypoint matches as reordered by the clustering stages
+    uint64_t kptMatchesHash;
+};
+
+struct BoxRecord { // bounding box including the ranges computed by the clustering stages
+    int32_t boxID, trackID, classID;
+    int32_t x, y, width, height;
+    float confidence;
+    int32_t lidarBegin, lidarSize;
+    int32_t matchBegin, matchSize;
+};
+
+struct KeypointRecord {
+    float x, y, size, angle, response;
+    int32_t octave, classID;
+    int32_t reserved;
+};
+
+struct MatchRecord {
+    int32_t queryIdx, trainIdx, imgIdx;
+    float distance;
+};
+
+struct BoxMatchRecord {
+    int32_t prevBoxID, currBoxID;
+};
+
+struct RecordedFrame { // pointers into a memory-mapped recording, valid as long as the reader is open
+
+    const FrameRecordHeader *header;
+    const BoxRecord *boxes;
+    const LidarPoint *lidarPoints;
+    const KeypointRecord *keypoints;
+    const uint8_t *descriptors;
+    const MatchRecord *kptMatches;
+    const BoxMatchRecord *bbMatches;
+    const TTCResult *ttcResults;
+};
+
+// FNV-1a hashes of the frame arrays reordered by clustering, used to compare replayed stages with the recording
+uint64_t hashLidarPoints(const std::vector<LidarPoint> &lidarPoints);
+uint64_t hashKptMatches(const std::vector<cv::DMatch> &kptMatches);
+
+class RecordingWriter
+{
+public:
+    RecordingWriter();
+    ~RecordingWriter(); // finishes the file if close() has not been called
+
+    bool open(const std::string &filename, const cv::Mat &P_rect_xx, const cv::Mat &R_rect_xx, const cv::Mat &RT,
+              float shrinkFactor, float clusterTolerance, bool bFilterClusters);
+
+    // frame holds the final results, lidarPointsIn and kptMatchesIn the stage inputs before they were reordered by clustering
+    void writeFrame(int frameIndex, double frameRate, const DataFrame &frame, const std::vector<LidarPoint> &lidarPointsIn,
+                    const std::vector<cv::DMatch> &kptMatchesIn);
+    void close();
+
+private:
+    void writePadded(const void *data, size_t nBytes);
+
+    FILE *stream;
+    RecordingHeader header;
+    std::vector<uint64_t> frameOffsets;
+    uint64_t offset;
+};
+
+class RecordingReader
+{
+public:
+    RecordingReader();
+    ~RecordingReader();
+
+    bool open(const std::string &filename);
+    const RecordingHeader &getHeader() const;
+    size_t size() const; // no. of recorded frames
+    RecordedFrame frame(size_t i) const;
+
+    // fill a data frame with the recorded stage inputs (boxes without ranges, Lidar points and keypoint matches before
+    // clustering); the descriptor matrix refers to the mapped file and must not be modified
+    void loadFrame(size_t i, DataFrame &frame) const;
+
+private:
+    const uint8_t *data;
+    size_t nBytes;
+    const uint64_t *frameTable;
+};
+
+#endif /* recording_hpp */
@@ -0,0 +1,163 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <opencv2/highgui/highgui.hpp>
+#include <opencv2/imgproc/imgproc.hpp>
+#include <opencv2/imgcodecs.hpp>
+
+#include "renderer.hpp"
+#include "camFusion.hpp"
+#include "lidarData.hpp"
+
+using namespace std;
+
+AsyncRenderer::AsyncRenderer(const RenderConfig &config)
+    : config(config), slots(config.queueSize < 1 ? 1 : config.queueSize), bStop(false), nDropped(0), nWritten(0), bNewImages(false)
+{
+    for (size_t i = 0; i < slots.size(); ++i)
+    {
+        freeSlots.push_back(i);
+    }
+    worker = thread(&AsyncRenderer::renderLoop, this);
+}
+
+AsyncRenderer::~AsyncRenderer()
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        bStop = true;
+    }
+    cvQueue.notify_one();
+    worker.join();
+
+    if (videoWriter.isOpened())
+    {
+        videoWriter.release();
+    }
+    cout << "Renderer : " << nWritten << " frames rendered, " << nDropped << " frames dropped" << endl;
+}
+
+RenderSnapshot *AsyncRenderer::tryAcquireSlot()
+{
+    lock_guard<mutex> lock(mtx);
+    if (freeSlots.empty())
+    {
+        ++nDropped;
+        return nullptr;
+    }
+
+    size_t slot = freeSlots.back();
+    freeSlots.pop_back();
+    return &slots[slot];
+}
+
+void AsyncRenderer::submit(RenderSnapshot *snapshot)
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        pendingSlots.push_back(snapshot - slots.data());
+    }
+    cvQueue.notify_one();
+}
+
+void AsyncRenderer::showLatest()
+{
+    cv::Mat topviewImg, visImg;
+    {
+        lock_guard<mutex> lock(mtx);
+        if (!bNewImages)
+        {
+            return;
+        }
+        topviewImg = latestTopviewImg;
+        visImg = latestVisImg;
+        bNewImages = false;
+    }
+
+    cv::namedWindow("3D Objects", 1);
+    cv::imshow("3D Objects", topviewImg);
+    cv::namedWindow("Final Results : TTC", 4);
+    cv::imshow("Final Results : TTC", visImg);
+    cv::waitKey(1); // process window events without blocking
+}
+
+size_t AsyncRenderer::droppedFrames()
+{
+    lock_guard<mutex> lock(mtx);
+    return nDropped;
+}
+
+void AsyncRenderer::renderLoop()
+{
+    unique_lock<mutex> lock(mtx);
+    while (true)
+    {
+        cvQueue.wait(lock, [this]() { return bStop || !pendingSlots.empty(); });
+        if (pendingSlots.empty()) // stop requested and all pending snapshots rendered
+        {
+            return;
+        }
+
+        size_t slot = pendingSlots.front();
+        pendingSlots.pop_front();
+
+        lock.unlock();
+        render(slots[slot]);
+        lock.lock();
+
+        freeSlots.push_back(slot);
+    }
+}
+
+void AsyncRenderer::render(RenderSnapshot &snapshot)
+{
+    // top view of all 3D objects
+    cv::Mat topviewImg = render3DObjects(snapshot.boundingBoxes, snapshot.lidarPoints, config.worldSize, config.topviewSize);
+
+    // camera image with Lidar overlay, bounding box and TTC for all objects
+    cv::Mat visImg = snapshot.cameraImg.clone();
+    for (auto it = snapshot.ttcResults.begin(); it != snapshot.ttcResults.end(); ++it)
+    {
+        const BoundingBox &currBB = snapshot.boundingBoxes[it->boxID];
+        showLidarImgOverlay(visImg, snapshot.lidarPoints, snapshot.lidarProjections, currBB.lidarPoints, &visImg);
+        cv::rectangle(visImg, cv::Point(currBB.roi.x, currBB.roi.y), cv::Point(currBB.roi.x + currBB.roi.width, currBB.roi.y + currBB.roi.height), cv::Scalar(0, 255, 0), 2);
+
+        char str[200];
+        sprintf(str, "track=%d : TTC Lidar : %f s, TTC Camera : %f s", currBB.trackID, it->ttcLidar, it->ttcCamera);
+        putText(visImg, str, cv::Point2f(80, 50 + 30 * (it - snapshot.ttcResults.begin())), cv::FONT_HERSHEY_PLAIN, 2, cv::Scalar(0,0,255));
+    }
+
+    if (config.outputType.compare("WINDOW") == 0)
+    {
+        // frames composed faster than they are displayed simply replace each other
+        lock_guard<mutex> lock(mtx);
+        latestTopviewImg = topviewImg;
+        latestVisImg = visImg;
+        bNewImages = true;
+        ++nWritten;
+        return;
+    }
+
+    // headless output : camera image and (scaled) top view side by side
+    cv::Mat topviewScaled;
+    cv::resize(topviewImg, topviewScaled, cv::Size(visImg.rows, visImg.rows));
+    cv::Mat composedImg(visImg.rows, visImg.cols + topviewScaled.cols, visImg.type());
+    visImg.copyTo(composedImg(cv::Rect(0, 0, visImg.cols, visImg.rows)));
+    topviewScaled.copyTo(composedImg(cv::Rect(visImg.cols, 0, topviewScaled.cols, topviewScaled.rows)));
+
+    if (config.outputType.compare("VIDEO") == 0)
+    {
+        if (!videoWriter.isOpened())
+        {
+            videoWriter.open(config.outputPath, cv::VideoWriter::fourcc('M', 'J', 'P', 'G'), config.frameRate, composedImg.size());
+        }
+        videoWriter.write(composedImg);
+    }
+    else if (config.outputType.compare("IMAGES") == 0)
+    {
+        ostringstream imgFilename;
+        imgFilename << config.outputPath << "/ttc_" << setfill('0') << setw(4) << snapshot.frameIndex << ".png";
+        cv::imwrite(imgFilename.str(), composedImg);
+    }
+    ++nWritten;
+}
@@ -0,0 +1,75 @@
+
+#ifndef renderer_hpp
+#define renderer_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <opencv2/core.hpp>
+#include <opencv2/videoio.hpp>
+
+#include "dataStructures.h"
+
+struct RenderSnapshot { // copy of everything needed to draw the results of one frame, held in a recycled renderer slot
+
+    int frameIndex; // index of the frame within the sequence
+    cv::Mat cameraImg; // own copy, the buffer is re-used across snapshots
+    std::vector<BoundingBox> boundingBoxes;
+    std::vector<LidarPoint> lidarPoints; // cloud the box spans refer to
+    std::vector<cv::Point3f> lidarProjections; // cached image projections of lidarPoints
+    std::vector<TTCResult> ttcResults;
+};
+
+struct RenderConfig {
+
+    std::string outputType; // WINDOW, VIDEO, IMAGES
+    std::string outputPath; // video file (e.g. ttc.avi) or directory for the image sequence
+    size_t queueSize;       // no. of snapshot slots, newer frames are dropped when all slots are in use
+    double frameRate;       // frame rate of the encoded video
+    cv::Size worldSize;     // area covered by the top view in [m]
+    cv::Size topviewSize;   // size of the top view image in pixels
+};
+
+// draws results on its own thread so that visualization never blocks the processing pipeline. Snapshots live in a
+// fixed set of slots whose buffers are re-used, and a frame is only copied once a free slot has been obtained.
+// Windows must be handled by the thread which owns the GUI, so in WINDOW mode the worker only composes the images
+// and showLatest() displays them.
+class AsyncRenderer
+{
+public:
+    explicit AsyncRenderer(const RenderConfig &config);
+    ~AsyncRenderer(); // renders all pending snapshots before returning
+
+    // free slot to be filled by the caller and passed to submit(), nullptr if the frame has to be dropped because
+    // the renderer is behind
+    RenderSnapshot *tryAcquireSlot();
+    void submit(RenderSnapshot *snapshot);
+    void showLatest(); // WINDOW mode : display the most recently composed images, to be called from the main thread
+    size_t droppedFrames();
+
+private:
+    void renderLoop();
+    void render(RenderSnapshot &snapshot);
+
+    RenderConfig config;
+    std::vector<RenderSnapshot> slots;
+    std::vector<size_t> freeSlots;
+    std::deque<size_t> pendingSlots; // filled slots in submission order
+    std::mutex mtx;
+    std::condition_variable cvQueue;
+    bool bStop;
+    size_t nDropped;
+    int nWritten;
+
+    cv::Mat latestTopviewImg, latestVisImg; // WINDOW mode : composed images waiting to be displayed
+    bool bNewImages;
+
+    cv::VideoWriter videoWriter;
+    std::thread worker;
+};
+
+#endif /* renderer_hpp */
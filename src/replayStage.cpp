@@ -0,0 +1,201 @@
+/* REPLAY A SINGLE PIPELINE STAGE FROM A RECORDING */
+#include <iostream>
+#include <string>
+#include <vector>
+#include <cstring>
+#include <cstdlib>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "camFusion.hpp"
+#include "lidarData.hpp"
+#include "recording.hpp"
+#include "framePipeline.hpp"
+
+using namespace std;
+
+struct Calibration {
+    cv::Mat P_rect, R_rect, RT;
+};
+
+// associate Lidar points with boxes exactly as the recorded pipeline did
+static void clusterLidar(DataFrame &frame, const RecordingHeader &header, Calibration &calib)
+{
+    projectLidarPoints(frame.lidarPoints, frame.lidarProjections, calib.P_rect, calib.R_rect, calib.RT);
+    clusterLidarWithROI(frame.boundingBoxes, frame.lidarPoints, frame.lidarProjections, header.shrinkFactor);
+    if (header.bFilterClusters)
+    {
+        for (auto it = frame.boundingBoxes.begin(); it != frame.boundingBoxes.end(); ++it)
+        {
+            keepDominantLidarCluster(frame.lidarPoints, frame.lidarProjections, it->lidarPoints, header.clusterTolerance);
+        }
+    }
+}
+
+static bool sameSpan(const IndexSpan &span, int32_t begin, int32_t size)
+{
+    return span.begin == begin && span.size == size;
+}
+
+// same matches in the same order, distances compared bit for bit
+static bool sameMatches(const vector<cv::DMatch> &matches, const MatchRecord *recMatches, uint32_t nRecMatches)
+{
+    bool bSame = matches.size() == nRecMatches;
+    for (size_t j = 0; bSame && j < matches.size(); ++j)
+    {
+        MatchRecord match = {matches[j].queryIdx, matches[j].trainIdx, matches[j].imgIdx, matches[j].distance};
+        bSame = memcmp(&match, &recMatches[j], sizeof(MatchRecord)) == 0;
+    }
+    return bSame;
+}
+
+int main(int argc, const char *argv[])
+{
+    if (argc < 3)
+    {
+        cout << "usage : " << argv[0] << " <recording> <stage> [repetitions]" << endl;
+        cout << "stages : MATCH_DESCRIPTORS, CLUSTER_LIDAR, CLUSTER_KPTS, MATCH_BOXES, TTC" << endl;
+        return 1;
+    }
+    string recordingFile = argv[1];
+    string stage = argv[2];
+    int repetitions = argc > 3 ? max(1, atoi(argv[3])) : 1;
+
+    if (stage.compare("MATCH_DESCRIPTORS") != 0 && stage.compare("CLUSTER_LIDAR") != 0 && stage.compare("CLUSTER_KPTS") != 0 &&
+        stage.compare("MATCH_BOXES") != 0 && stage.compare("TTC") != 0)
+    {
+        cerr << "Unknown stage " << stage << endl;
+        return 1;
+    }
+
+    RecordingReader reader;
+    if (!reader.open(recordingFile))
+    {
+        return 1;
+    }
+    const RecordingHeader &header = reader.getHeader();
+
+    Calibration calib;
+    calib.P_rect = cv::Mat(3, 4, cv::DataType<double>::type, (void *)header.P_rect).clone();
+    calib.R_rect = cv::Mat(4, 4, cv::DataType<double>::type, (void *)header.R_rect).clone();
+    calib.RT = cv::Mat(4, 4, cv::DataType<double>::type, (void *)header.RT).clone();
+
+    // descriptor matching with the matcher configuration of the recorded program
+    FeaturePipelineType featurePipeline(false);
+
+    DataFrame prevFrame, currFrame;
+    double tTotal = 0.0;
+    size_t nRuns = 0, nMismatches = 0;
+
+    for (size_t i = 0; i < reader.size(); ++i)
+    {
+        RecordedFrame rec = reader.frame(i);
+        bool bHasPrev = i > 0;
+        bool bNeedsPrev = stage.compare("CLUSTER_LIDAR") != 0;
+
+        // run the stage on freshly loaded inputs, only the stage itself is timed
+        vector<TTCResult> ttcResults;
+        for (int rep = 0; rep < repetitions && (bHasPrev || !bNeedsPrev); ++rep)
+        {
+            reader.loadFrame(i, currFrame);
+            if (stage.compare("TTC") == 0)
+            {
+                clusterLidar(currFrame, header, calib);
+                clusterKptMatchesWithROI(currFrame.boundingBoxes, prevFrame.keypoints, currFrame.keypoints, currFrame.kptMatches);
+            }
+
+            double t = (double)cv::getTickCount();
+            if (stage.compare("MATCH_DESCRIPTORS") == 0)
+            {
+                featurePipeline.match(prevFrame.descriptors, currFrame.descriptors, currFrame.kptMatches);
+            }
+            else if (stage.compare("CLUSTER_LIDAR") == 0)
+            {
+                clusterLidar(currFrame, header, calib);
+            }
+            else if (stage.compare("CLUSTER_KPTS") == 0)
+            {
+                clusterKptMatchesWithROI(currFrame.boundingBoxes, prevFrame.keypoints, currFrame.keypoints, currFrame.kptMatches);
+            }
+            else if (stage.compare("MATCH_BOXES") == 0)
+            {
+                matchBoundingBoxes(currFrame.kptMatches, currFrame.bbMatches, prevFrame, currFrame);
+            }
+            else if (stage.compare("TTC") == 0)
+            {
+                ttcResults.assign(rec.ttcResults, rec.ttcResults + rec.header->nTTCResults);
+                for (auto it = ttcResults.begin(); it != ttcResults.end(); ++it)
+                {
+                    const BoundingBox &prevBB = prevFrame.boundingBoxes[it->prevBoxID];
+                    const BoundingBox &currBB = currFrame.boundingBoxes[it->boxID];
+                    computeTTCLidar(prevFrame.lidarPoints, prevBB.lidarPoints, currFrame.lidarPoints, currBB.lidarPoints, rec.header->frameRate, it->ttcLidar);
+                    computeTTCCamera(prevFrame.keypoints, currFrame.keypoints, currFrame.kptMatches, currBB.kptMatches, rec.header->frameRate, it->ttcCamera);
+                }
+            }
+            tTotal += ((double)cv::getTickCount() - t) / cv::getTickFrequency();
+            ++nRuns;
+        }
+
+        // compare the result of the last run bit for bit with the recording
+        bool bMatch = true;
+        if (!bHasPrev && bNeedsPrev)
+        {
+            // nothing to compare, the stage needs a previous frame
+        }
+        else if (stage.compare("MATCH_DESCRIPTORS") == 0)
+        {
+            // the recorded matches are the matcher output, as passed into clusterKptMatchesWithROI
+            bMatch = sameMatches(currFrame.kptMatches, rec.kptMatches, rec.header->nKptMatches);
+        }
+        else if (stage.compare("CLUSTER_LIDAR") == 0)
+        {
+            // same ranges and same order of the points within them
+            bMatch = hashLidarPoints(currFrame.lidarPoints) == rec.header->lidarPointsHash;
+            for (size_t j = 0; j < currFrame.boundingBoxes.size(); ++j)
+            {
+                bMatch = bMatch && sameSpan(currFrame.boundingBoxes[j].lidarPoints, rec.boxes[j].lidarBegin, rec.boxes[j].lidarSize);
+            }
+        }
+        else if (stage.compare("CLUSTER_KPTS") == 0)
+        {
+            bMatch = hashKptMatches(currFrame.kptMatches) == rec.header->kptMatchesHash;
+            for (size_t j = 0; j < currFrame.boundingBoxes.size(); ++j)
+            {
+                bMatch = bMatch && sameSpan(currFrame.boundingBoxes[j].kptMatches, rec.boxes[j].matchBegin, rec.boxes[j].matchSize);
+            }
+        }
+        else if (stage.compare("MATCH_BOXES") == 0)
+        {
+            bMatch = currFrame.bbMatches.size() == rec.header->nBBMatches;
+            size_t j = 0;
+            for (auto it = currFrame.bbMatches.begin(); bMatch && it != currFrame.bbMatches.end(); ++it, ++j)
+            {
+                bMatch = it->first == rec.bbMatches[j].prevBoxID && it->second == rec.bbMatches[j].currBoxID;
+            }
+        }
+        else if (stage.compare("TTC") == 0)
+        {
+            // memcmp also treats identical NaN values as equal
+            bMatch = ttcResults.empty() || memcmp(ttcResults.data(), rec.ttcResults, ttcResults.size() * sizeof(TTCResult)) == 0;
+        }
+
+        if (!bMatch)
+        {
+            cout << "frame " << rec.header->frameIndex << " : result differs from recording" << endl;
+            ++nMismatches;
+        }
+
+        // bring the frame into the fully processed state required as previous frame of the next iteration
+        reader.loadFrame(i, currFrame);
+        clusterLidar(currFrame, header, calib);
+        if (bHasPrev)
+        {
+            clusterKptMatchesWithROI(currFrame.boundingBoxes, prevFrame.keypoints, currFrame.keypoints, currFrame.kptMatches);
+        }
+        swap(prevFrame, currFrame);
+    }
+
+    cout << stage << " : " << nRuns << " runs over " << reader.size() << " frames, " << 1000 * tTotal / max((size_t)1, nRuns) << " ms per run" << endl;
+    cout << (nMismatches == 0 ? "all results identical to recording" : "results differ from recording in some frames") << endl;
+    return nMismatches == 0 ? 0 : 2;
+}
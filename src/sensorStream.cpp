@@ -0,0 +1,624 @@
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <cerrno>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "sensorStream.hpp"
+
+using namespace std;
+
+static_assert(sizeof(SensorMessageHeader) % 8 == 0, "Lidar points following a message header must stay 8-byte aligned");
+
+static const uint32_t sensorMessageMagic = 0x444E4653; // "SFND"
+static const size_t slotAlignment = 64;
+
+static size_t slotsHeaderBytes()
+{
+    return (sizeof(CameraSlotsHeader) + slotAlignment - 1) & ~(slotAlignment - 1);
+}
+
+static uint8_t *slotData(CameraSlotsHeader *slots, uint32_t slot)
+{
+    return (uint8_t *)slots + slotsHeaderBytes() + slot * slots->slotSize;
+}
+
+// read or write exactly nBytes, retrying on partial transfers and interrupts
+static bool readFully(int fd, void *data, size_t nBytes)
+{
+    uint8_t *ptr = (uint8_t *)data;
+    while (nBytes > 0)
+    {
+        ssize_t n = read(fd, ptr, nBytes);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        ptr += n;
+        nBytes -= n;
+    }
+    return true;
+}
+
+static bool writeFully(int fd, const void *data, size_t nBytes)
+{
+    const uint8_t *ptr = (const uint8_t *)data;
+    while (nBytes > 0)
+    {
+        ssize_t n = write(fd, ptr, nBytes);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        ptr += n;
+        nBytes -= n;
+    }
+    return true;
+}
+
+// write as much as fits without blocking, nWritten receives the no. of bytes written; false on error
+static bool writeAvailable(int fd, const void *data, size_t nBytes, size_t &nWritten)
+{
+    const uint8_t *ptr = (const uint8_t *)data;
+    nWritten = 0;
+    while (nWritten < nBytes)
+    {
+        ssize_t n = write(fd, ptr + nWritten, nBytes - nWritten);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        {
+            return true;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        nWritten += n;
+    }
+    return true;
+}
+
+static bool makeSocketAddress(const std::string &path, sockaddr_un &addr)
+{
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path))
+    {
+        cerr << "Socket path too long : " << path << endl;
+        return false;
+    }
+    strcpy(addr.sun_path, path.c_str());
+    return true;
+}
+
+
+SensorStreamReceiver::SensorStreamReceiver() : fd(-1), slots(nullptr), shmBytes(0), maxTimeOffset(0.0), nHeldFrames(0), nDropped(0), bEnded(false)
+{
+}
+
+SensorStreamReceiver::~SensorStreamReceiver()
+{
+    close();
+}
+
+bool SensorStreamReceiver::open(const std::string &endpointType, const std::string &endpointPath, const std::string &shmName,
+                                double maxTimeOffset, size_t nHeldFrames)
+{
+    this->maxTimeOffset = maxTimeOffset;
+    this->nHeldFrames = nHeldFrames;
+    bEnded = false;
+
+    // wait for the publisher
+    if (endpointType.compare("UNIX_SOCKET") == 0)
+    {
+        sockaddr_un addr;
+        if (!makeSocketAddress(endpointPath, addr))
+        {
+            return false;
+        }
+        int listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(endpointPath.c_str());
+        if (listenFd < 0 || bind(listenFd, (sockaddr *)&addr, sizeof(addr)) != 0 || listen(listenFd, 1) != 0)
+        {
+            cerr << "Unable to listen on socket " << endpointPath << " : " << strerror(errno) << endl;
+            if (listenFd >= 0)
+            {
+                ::close(listenFd);
+            }
+            return false;
+        }
+        this->endpointPath = endpointPath;
+        cout << "Waiting for sensor stream on " << endpointPath << endl;
+        fd = accept(listenFd, nullptr, nullptr);
+        ::close(listenFd);
+    }
+    else if (endpointType.compare("FIFO") == 0)
+    {
+        if (mkfifo(endpointPath.c_str(), 0600) != 0 && errno != EEXIST)
+        {
+            cerr << "Unable to create named pipe " << endpointPath << " : " << strerror(errno) << endl;
+            return false;
+        }
+        this->endpointPath = endpointPath;
+        cout << "Waiting for sensor stream on " << endpointPath << endl;
+        fd = ::open(endpointPath.c_str(), O_RDONLY);
+    }
+    else
+    {
+        cerr << "Unknown endpoint type " << endpointType << endl;
+        return false;
+    }
+    if (fd < 0)
+    {
+        cerr << "Unable to connect sensor stream " << endpointPath << " : " << strerror(errno) << endl;
+        close();
+        return false;
+    }
+
+    // the publisher has created the image slots before connecting
+    int shmFd = shm_open(shmName.c_str(), O_RDWR, 0);
+    struct stat shmStat;
+    if (shmFd < 0 || fstat(shmFd, &shmStat) != 0 || (size_t)shmStat.st_size < slotsHeaderBytes())
+    {
+        cerr << "Unable to open image slots " << shmName << endl;
+        if (shmFd >= 0)
+        {
+            ::close(shmFd);
+        }
+        close();
+        return false;
+    }
+    shmBytes = shmStat.st_size;
+    void *mapped = mmap(nullptr, shmBytes, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    ::close(shmFd);
+    if (mapped == MAP_FAILED)
+    {
+        cerr << "Unable to map image slots " << shmName << endl;
+        shmBytes = 0;
+        close();
+        return false;
+    }
+    slots = (CameraSlotsHeader *)mapped;
+    if (slots->nSlots > (uint32_t)maxCameraSlots || slotsHeaderBytes() + slots->nSlots * slots->slotSize > shmBytes)
+    {
+        cerr << "Invalid image slots " << shmName << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+bool SensorStreamReceiver::receiveMessage()
+{
+    SensorMessageHeader msg;
+    if (fd < 0 || !readFully(fd, &msg, sizeof(msg)) || msg.magic != sensorMessageMagic || msg.type == SENSOR_MSG_END)
+    {
+        return false;
+    }
+
+    if (msg.type == SENSOR_MSG_CAMERA)
+    {
+        if (msg.slot >= slots->nSlots || msg.rows < 0 || msg.cols < 0 ||
+            (uint64_t)msg.rows * msg.cols * CV_ELEM_SIZE(msg.imgType) > slots->slotSize)
+        {
+            cerr << "Invalid camera message" << endl;
+            return false;
+        }
+        PendingCamera camera = {msg.timestamp, msg.slot, msg.rows, msg.cols, msg.imgType};
+        pendingCameras.push_back(camera);
+
+        // the other sensor has stopped delivering, keep only the newest images
+        if (pendingCameras.size() > maxPendingMessages)
+        {
+            dropCamera();
+        }
+    }
+    else if (msg.type == SENSOR_MSG_LIDAR)
+    {
+        // read the points into a recycled buffer
+        pendingLidars.push_back(PendingLidar());
+        PendingLidar &lidar = pendingLidars.back();
+        lidar.timestamp = msg.timestamp;
+        if (!freeLidarBuffers.empty())
+        {
+            lidar.points.swap(freeLidarBuffers.back());
+            freeLidarBuffers.pop_back();
+        }
+        lidar.points.resize(msg.nPoints);
+        if (msg.nPoints > 0 && !readFully(fd, lidar.points.data(), msg.nPoints * sizeof(LidarPoint)))
+        {
+            return false;
+        }
+
+        if (pendingLidars.size() > maxPendingMessages)
+        {
+            dropLidar();
+        }
+    }
+    return true;
+}
+
+bool SensorStreamReceiver::isMessageReadable() const
+{
+    pollfd pfd = {fd, POLLIN, 0};
+    return fd >= 0 && poll(&pfd, 1, 0) > 0 && (pfd.revents & (POLLIN | POLLHUP)) != 0;
+}
+
+void SensorStreamReceiver::releaseSlot(uint32_t slot)
+{
+    __atomic_store_n(&slots->slotState[slot], 0u, __ATOMIC_RELEASE);
+}
+
+void SensorStreamReceiver::dropCamera()
+{
+    releaseSlot(pendingCameras.front().slot);
+    pendingCameras.pop_front();
+    ++nDropped;
+}
+
+void SensorStreamReceiver::dropLidar()
+{
+    freeLidarBuffers.push_back(std::move(pendingLidars.front().points));
+    pendingLidars.pop_front();
+    ++nDropped;
+}
+
+bool SensorStreamReceiver::next(double &timestamp, cv::Mat &cameraImg, std::vector<LidarPoint> &lidarPoints)
+{
+    // read everything which has arrived while the previous frame was processed
+    while (!bEnded && isMessageReadable())
+    {
+        bEnded = !receiveMessage();
+    }
+
+    while (true)
+    {
+        // both streams arrive in time order : pair the oldest messages or drop the one without a partner
+        while (!pendingCameras.empty() && !pendingLidars.empty())
+        {
+            // a newer message of both sensors has arrived, so the older of the two oldest ones cannot be part of the
+            // newest pair
+            if (pendingCameras.size() > 1 && pendingLidars.size() > 1)
+            {
+                if (pendingCameras.front().timestamp < pendingLidars.front().timestamp)
+                {
+                    dropCamera();
+                }
+                else
+                {
+                    dropLidar();
+                }
+                continue;
+            }
+
+            const PendingCamera &camera = pendingCameras.front();
+            const PendingLidar &lidar = pendingLidars.front();
+            double dt = camera.timestamp - lidar.timestamp;
+
+            // a later message of the other sensor may be closer in time
+            if (dt > 0 && pendingLidars.size() > 1 && fabs(camera.timestamp - pendingLidars[1].timestamp) <= dt)
+            {
+                dropLidar();
+                continue;
+            }
+            if (dt < 0 && pendingCameras.size() > 1 && fabs(pendingCameras[1].timestamp - lidar.timestamp) <= -dt)
+            {
+                dropCamera();
+                continue;
+            }
+
+            if (fabs(dt) > maxTimeOffset)
+            {
+                if (dt > 0)
+                {
+                    dropLidar();
+                }
+                else
+                {
+                    dropCamera();
+                }
+                continue;
+            }
+
+            // image stays in its slot, the scan is swapped into the caller's buffer
+            timestamp = camera.timestamp;
+            cameraImg = cv::Mat(camera.rows, camera.cols, camera.imgType, slotData(slots, camera.slot));
+            lidarPoints.swap(pendingLidars.front().points);
+            pendingLidars.front().points.clear();
+            freeLidarBuffers.push_back(std::move(pendingLidars.front().points));
+            pendingLidars.pop_front();
+
+            heldSlots.push_back(camera.slot);
+            pendingCameras.pop_front();
+            while (heldSlots.size() > nHeldFrames)
+            {
+                releaseSlot(heldSlots.front());
+                heldSlots.pop_front();
+            }
+            return true;
+        }
+
+        if (bEnded || !receiveMessage())
+        {
+            bEnded = true;
+            return false;
+        }
+    }
+}
+
+size_t SensorStreamReceiver::droppedMessages() const
+{
+    return nDropped;
+}
+
+void SensorStreamReceiver::close()
+{
+    if (slots != nullptr)
+    {
+        while (!pendingCameras.empty())
+        {
+            releaseSlot(pendingCameras.front().slot);
+            pendingCameras.pop_front();
+        }
+        while (!heldSlots.empty())
+        {
+            releaseSlot(heldSlots.front());
+            heldSlots.pop_front();
+        }
+        munmap(slots, shmBytes);
+        slots = nullptr;
+        shmBytes = 0;
+    }
+    pendingLidars.clear();
+
+    if (fd >= 0)
+    {
+        ::close(fd);
+        fd = -1;
+    }
+    if (!endpointPath.empty())
+    {
+        unlink(endpointPath.c_str());
+        endpointPath.clear();
+    }
+}
+
+
+SensorStreamPublisher::SensorStreamPublisher() : fd(-1), pendingOffset(0), slots(nullptr), shmBytes(0), nextSlot(0)
+{
+}
+
+SensorStreamPublisher::~SensorStreamPublisher()
+{
+    close();
+}
+
+bool SensorStreamPublisher::open(const std::string &endpointType, const std::string &endpointPath, const std::string &shmName,
+                                 size_t nSlots, size_t slotSize)
+{
+    if (nSlots < 1 || nSlots > (size_t)maxCameraSlots)
+    {
+        cerr << "No. of image slots must be between 1 and " << maxCameraSlots << endl;
+        return false;
+    }
+    slotSize = (slotSize + slotAlignment - 1) & ~(slotAlignment - 1);
+
+    // create the image slots, all of them free
+    int shmFd = shm_open(shmName.c_str(), O_CREAT | O_RDWR, 0600);
+    shmBytes = slotsHeaderBytes() + nSlots * slotSize;
+    if (shmFd < 0 || ftruncate(shmFd, shmBytes) != 0)
+    {
+        cerr << "Unable to create image slots " << shmName << " : " << strerror(errno) << endl;
+        if (shmFd >= 0)
+        {
+            ::close(shmFd);
+            shm_unlink(shmName.c_str());
+        }
+        shmBytes = 0;
+        return false;
+    }
+    void *mapped = mmap(nullptr, shmBytes, PROT_READ | PROT_WRITE, MAP_SHARED, shmFd, 0);
+    ::close(shmFd);
+    if (mapped == MAP_FAILED)
+    {
+        cerr << "Unable to map image slots " << shmName << endl;
+        shm_unlink(shmName.c_str());
+        shmBytes = 0;
+        return false;
+    }
+    this->shmName = shmName;
+    slots = (CameraSlotsHeader *)mapped;
+    memset(slots, 0, sizeof(CameraSlotsHeader));
+    slots->nSlots = nSlots;
+    slots->slotSize = slotSize;
+
+    // connect to the waiting receiver
+    if (endpointType.compare("UNIX_SOCKET") == 0)
+    {
+        sockaddr_un addr;
+        if (makeSocketAddress(endpointPath, addr))
+        {
+            fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd >= 0 && connect(fd, (sockaddr *)&addr, sizeof(addr)) != 0)
+            {
+                ::close(fd);
+                fd = -1;
+            }
+        }
+    }
+    else if (endpointType.compare("FIFO") == 0)
+    {
+        fd = ::open(endpointPath.c_str(), O_WRONLY);
+    }
+    else
+    {
+        cerr << "Unknown endpoint type " << endpointType << endl;
+    }
+    if (fd < 0 || fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) | O_NONBLOCK) != 0)
+    {
+        cerr << "Unable to connect to sensor stream receiver " << endpointPath << endl;
+        close();
+        return false;
+    }
+    pendingBytes.clear();
+    pendingOffset = 0;
+    return true;
+}
+
+bool SensorStreamPublisher::flushPending()
+{
+    size_t nWritten;
+    if (!writeAvailable(fd, pendingBytes.data() + pendingOffset, pendingBytes.size() - pendingOffset, nWritten))
+    {
+        return false;
+    }
+    pendingOffset += nWritten;
+    if (pendingOffset == pendingBytes.size())
+    {
+        pendingBytes.clear(); // keeps the capacity for the next message in transit
+        pendingOffset = 0;
+    }
+    return true;
+}
+
+PublishResult SensorStreamPublisher::sendMessage(const SensorMessageHeader &msg, const void *payload, size_t payloadBytes)
+{
+    // hand over what fits, the rest goes out with the following calls
+    size_t nHeader = 0, nPayload = 0;
+    if (pendingBytes.empty())
+    {
+        if (!writeAvailable(fd, &msg, sizeof(msg), nHeader) ||
+            (nHeader == sizeof(msg) && payloadBytes > 0 && !writeAvailable(fd, payload, payloadBytes, nPayload)))
+        {
+            return PublishResult::FAILED;
+        }
+    }
+    pendingBytes.insert(pendingBytes.end(), (const uint8_t *)&msg + nHeader, (const uint8_t *)&msg + sizeof(msg));
+    pendingBytes.insert(pendingBytes.end(), (const uint8_t *)payload + nPayload, (const uint8_t *)payload + payloadBytes);
+    return PublishResult::SENT;
+}
+
+PublishResult SensorStreamPublisher::publishCamera(double timestamp, const cv::Mat &img)
+{
+    if (fd < 0)
+    {
+        return PublishResult::FAILED;
+    }
+    size_t imgBytes = img.total() * img.elemSize();
+    if (imgBytes > slots->slotSize)
+    {
+        cerr << "Image of " << imgBytes << " bytes does not fit into an image slot of " << slots->slotSize << " bytes" << endl;
+        return PublishResult::FAILED;
+    }
+
+    // image messages are small and bounded by the no. of slots, so they queue up behind a message in transit
+    if (!flushPending())
+    {
+        return PublishResult::FAILED;
+    }
+
+    // find a slot which the receiver has handed back
+    uint32_t slot = slots->nSlots;
+    for (uint32_t i = 0; i < slots->nSlots; ++i)
+    {
+        uint32_t candidate = (nextSlot + i) % slots->nSlots;
+        if (__atomic_load_n(&slots->slotState[candidate], __ATOMIC_ACQUIRE) == 0)
+        {
+            slot = candidate;
+            break;
+        }
+    }
+    if (slot == slots->nSlots)
+    {
+        return PublishResult::DROPPED; // receiver is behind, a live sensor cannot wait
+    }
+
+    cv::Mat slotImg(img.rows, img.cols, img.type(), slotData(slots, slot));
+    img.copyTo(slotImg);
+    __atomic_store_n(&slots->slotState[slot], 1u, __ATOMIC_RELEASE);
+    nextSlot = (slot + 1) % slots->nSlots;
+
+    SensorMessageHeader msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.magic = sensorMessageMagic;
+    msg.type = SENSOR_MSG_CAMERA;
+    msg.timestamp = timestamp;
+    msg.slot = slot;
+    msg.rows = img.rows;
+    msg.cols = img.cols;
+    msg.imgType = img.type();
+    return sendMessage(msg, nullptr, 0);
+}
+
+PublishResult SensorStreamPublisher::publishLidar(double timestamp, const std::vector<LidarPoint> &lidarPoints)
+{
+    if (fd < 0)
+    {
+        return PublishResult::FAILED;
+    }
+
+    SensorMessageHeader msg;
+    memset(&msg, 0, sizeof(msg));
+    msg.magic = sensorMessageMagic;
+    msg.type = SENSOR_MSG_LIDAR;
+    msg.timestamp = timestamp;
+    msg.nPoints = lidarPoints.size();
+
+    // a scan is only sent if the receiver has taken everything before it, so at most one scan is in transit
+    if (!flushPending())
+    {
+        return PublishResult::FAILED;
+    }
+    if (!pendingBytes.empty())
+    {
+        return PublishResult::DROPPED;
+    }
+    return sendMessage(msg, lidarPoints.data(), lidarPoints.size() * sizeof(LidarPoint));
+}
+
+void SensorStreamPublisher::close()
+{
+    if (fd >= 0)
+    {
+        // the end of the stream must arrive, so wait for the receiver from here on
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+        SensorMessageHeader msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.magic = sensorMessageMagic;
+        msg.type = SENSOR_MSG_END;
+        if (writeFully(fd, pendingBytes.data() + pendingOffset, pendingBytes.size() - pendingOffset))
+        {
+            writeFully(fd, &msg, sizeof(msg));
+        }
+        pendingBytes.clear();
+        pendingOffset = 0;
+        ::close(fd);
+        fd = -1;
+    }
+
+    // the receiver keeps its own mapping, removing the name only prevents new ones
+    if (slots != nullptr)
+    {
+        munmap(slots, shmBytes);
+        slots = nullptr;
+        shmBytes = 0;
+        shm_unlink(shmName.c_str());
+    }
+}
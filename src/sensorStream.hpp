@@ -0,0 +1,132 @@
+
+#ifndef sensorStream_hpp
+#define sensorStream_hpp
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <deque>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+
+// Streaming ingestion of timestamped camera images and Lidar scans from a local publisher (e.g. a sensor driver or
+// kitti_replayer). Messages are sent over a Unix domain socket or a named pipe; Lidar points follow their message
+// header directly, while images are placed in slots of a shared-memory segment and only the slot index is sent, so
+// that the receiver can work on the pixels without copying them. The publisher never waits for the receiver : a
+// message which cannot be handed over immediately is dropped, and the receiver pairs the newest messages it has.
+//
+// message : SensorMessageHeader | LidarPoint[nPoints] (Lidar only)
+// segment : CameraSlotsHeader | slot 0 | slot 1 | ... (each slot holds one continuous image of up to slotSize bytes)
+
+enum SensorMessageType { SENSOR_MSG_CAMERA = 1, SENSOR_MSG_LIDAR = 2, SENSOR_MSG_END = 3 };
+
+struct SensorMessageHeader {
+    uint32_t magic;     // sensorMessageMagic
+    uint32_t type;      // SensorMessageType
+    double timestamp;   // acquisition time in [s]
+    uint32_t slot;      // camera : shared-memory slot which holds the image
+    int32_t rows, cols; // camera : image size
+    int32_t imgType;    // camera : OpenCV type of the image, e.g. CV_8UC3
+    uint32_t nPoints;   // Lidar : no. of points following the header
+    uint32_t reserved;
+};
+
+const int maxCameraSlots = 16;
+const size_t maxPendingMessages = 16; // unpaired messages kept per sensor, older ones are dropped
+
+struct CameraSlotsHeader {
+    uint32_t nSlots;
+    uint32_t reserved;
+    uint64_t slotSize;                 // bytes per slot, multiple of 64
+    uint32_t slotState[maxCameraSlots]; // 0 = free (publisher may write), 1 = handed to the receiver; accessed atomically
+};
+
+// pipeline side : accepts one publisher and delivers camera images paired with the Lidar scan closest in time
+class SensorStreamReceiver
+{
+public:
+    SensorStreamReceiver();
+    ~SensorStreamReceiver();
+
+    // endpointType is UNIX_SOCKET or FIFO; blocks until the publisher has connected. The images of the last nHeldFrames
+    // frames stay valid, older slots are handed back to the publisher.
+    bool open(const std::string &endpointType, const std::string &endpointPath, const std::string &shmName,
+              double maxTimeOffset, size_t nHeldFrames);
+
+    // next pair of camera image and Lidar scan; all messages which have arrived are read first and older pairs are
+    // skipped in favor of the newest one. cameraImg refers to shared memory, lidarPoints is swapped with an internal
+    // buffer so that its capacity is re-used. Returns false at the end of the stream.
+    bool next(double &timestamp, cv::Mat &cameraImg, std::vector<LidarPoint> &lidarPoints);
+
+    size_t droppedMessages() const; // messages without a partner within maxTimeOffset or superseded by newer ones
+    void close();
+
+private:
+    struct PendingCamera {
+        double timestamp;
+        uint32_t slot;
+        int rows, cols, imgType;
+    };
+    struct PendingLidar {
+        double timestamp;
+        std::vector<LidarPoint> points;
+    };
+
+    bool receiveMessage(); // false at end of stream or on error
+    bool isMessageReadable() const; // true if a message has arrived which can be read without waiting for the publisher
+    void releaseSlot(uint32_t slot);
+    void dropCamera();
+    void dropLidar();
+
+    int fd;
+    std::string endpointPath; // socket or named pipe created by open(), removed on close
+    CameraSlotsHeader *slots;
+    size_t shmBytes;
+    double maxTimeOffset;
+    size_t nHeldFrames;
+
+    std::deque<PendingCamera> pendingCameras;
+    std::deque<PendingLidar> pendingLidars;
+    std::vector<std::vector<LidarPoint>> freeLidarBuffers; // recycled point buffers of consumed scans
+    std::deque<uint32_t> heldSlots; // slots of the frames which were delivered last
+    size_t nDropped;
+    bool bEnded; // end of stream (or error) has been read, the pending messages can still be paired
+};
+
+enum class PublishResult {
+    SENT,    // message delivered to the receiver
+    DROPPED, // message not sent because the receiver is behind (all image slots held or the previous message still
+             // in transit), the stream continues
+    FAILED   // receiver gone or write error, the stream cannot continue
+};
+
+// sensor side : creates the image slots and sends messages to a waiting receiver
+class SensorStreamPublisher
+{
+public:
+    SensorStreamPublisher();
+    ~SensorStreamPublisher(); // sends the end-of-stream message if close() has not been called
+
+    bool open(const std::string &endpointType, const std::string &endpointPath, const std::string &shmName,
+              size_t nSlots, size_t slotSize);
+
+    PublishResult publishCamera(double timestamp, const cv::Mat &img);
+    PublishResult publishLidar(double timestamp, const std::vector<LidarPoint> &lidarPoints);
+    void close(); // waits until the last message has been handed over
+
+private:
+    bool flushPending(); // hand over as much of the message in transit as the receiver accepts, false on error
+    PublishResult sendMessage(const SensorMessageHeader &msg, const void *payload, size_t payloadBytes); // queues the rest
+
+    int fd; // non-blocking
+    std::vector<uint8_t> pendingBytes; // remainder of a message the receiver has not accepted yet, from pendingOffset on
+    size_t pendingOffset;
+    std::string shmName; // removed on close
+    CameraSlotsHeader *slots;
+    size_t shmBytes;
+    uint32_t nextSlot;
+};
+
+#endif /* sensorStream_hpp */
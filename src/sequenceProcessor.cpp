@@ -0,0 +1,69 @@
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+
+#include "sequenceProcessor.hpp"
+#include "lidarData.hpp"
+#include "frameBuffer.hpp"
+#include "threadPool.hpp"
+
+using namespace std;
+
+void processSequence(const SequenceConfig &config, ObjectDetector &objectDetector, size_t nThreads, SequenceResult &result)
+{
+    result = SequenceResult();
+    result.name = config.name;
+
+    FrameBuffer dataBuffer(2);
+    ThreadPool threadPool(nThreads);
+    vector<unsigned char> imgFileBuffer; // encoded image, re-used across frames
+
+    // same stage parameters as the main program, only calibration and frame rate differ between sequences
+    FramePipelineConfig pipelineConfig;
+    pipelineConfig.P_rect_xx = config.P_rect_xx;
+    pipelineConfig.R_rect_xx = config.R_rect_xx;
+    pipelineConfig.RT = config.RT;
+    pipelineConfig.nominalFrameRate = config.sensorRate / config.imgStepWidth;
+    pipelineConfig.bVerbose = false; // several sequences run at the same time
+    FramePipeline framePipeline(pipelineConfig, objectDetector, nullptr, threadPool);
+
+    for (int imgIndex = 0; imgIndex <= config.imgEndIndex - config.imgStartIndex; imgIndex += config.imgStepWidth)
+    {
+        double tFrame = (double)cv::getTickCount();
+
+        /* LOAD IMAGE AND LIDAR SCAN INTO BUFFER */
+
+        ostringstream imgNumber;
+        imgNumber << setfill('0') << setw(config.imgFillWidth) << config.imgStartIndex + imgIndex;
+
+        DataFrame &frame = dataBuffer.acquire();
+        frame.timestamp = (config.imgStartIndex + imgIndex) / config.sensorRate;
+        if (!loadImageFromFile(imgFileBuffer, frame.cameraImg, config.imgPrefix + imgNumber.str() + config.imgFileType))
+        {
+            cerr << config.name << " : unable to read image " << config.imgPrefix + imgNumber.str() + config.imgFileType << endl;
+            return;
+        }
+        if (!loadLidarFromFile(frame.lidarPoints, config.lidarPrefix + imgNumber.str() + config.lidarFileType))
+        {
+            cerr << config.name << " : unable to read Lidar scan " << config.lidarPrefix + imgNumber.str() + config.lidarFileType << endl;
+            return;
+        }
+
+        /* PROCESS FRAME */
+
+        framePipeline.processFrame(dataBuffer, QualityLevel::FULL, nullptr, &result.times);
+        for (auto it = frame.ttcResults.begin(); it != frame.ttcResults.end(); ++it)
+        {
+            SequenceTTC entry;
+            entry.frameIndex = config.imgStartIndex + imgIndex;
+            entry.trackID = frame.boundingBoxes[it->boxID].trackID;
+            entry.ttc = *it;
+            result.ttcResults.push_back(entry);
+        }
+
+        result.times.total += ((double)cv::getTickCount() - tFrame) / cv::getTickFrequency();
+        ++result.nFrames;
+    }
+
+    result.bOk = true;
+}
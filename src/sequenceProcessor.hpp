@@ -0,0 +1,48 @@
+
+#ifndef sequenceProcessor_hpp
+#define sequenceProcessor_hpp
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+#include "objectDetection2D.hpp"
+#include "framePipeline.hpp"
+
+struct SequenceConfig { // one recorded drive to be processed by the batch driver
+
+    std::string name;
+    std::string imgPrefix;     // full path up to the file index, e.g. .../image_02/data/
+    std::string imgFileType;
+    std::string lidarPrefix;   // full path up to the file index, e.g. .../velodyne_points/data/
+    std::string lidarFileType;
+    int imgStartIndex;         // first file index to load
+    int imgEndIndex;           // last file index to load
+    int imgStepWidth;
+    int imgFillWidth;          // no. of digits which make up the file index
+    double sensorRate;         // frames per second delivered by Lidar and camera
+    cv::Mat P_rect_xx, R_rect_xx, RT; // calibration of camera and Lidar
+};
+
+struct SequenceTTC { // TTC of one matched bounding box in one frame
+    int frameIndex;
+    int trackID;
+    TTCResult ttc;
+};
+
+struct SequenceResult {
+    std::string name;
+    bool bOk = false;        // false if an image or Lidar file could not be read
+    int nFrames = 0;         // no. of processed frames
+    std::vector<SequenceTTC> ttcResults; // in frame order, within a frame ordered by boxID
+    StageTimes times;
+};
+
+// run the full pipeline (same stages and parameters as the main program, without visualization and progress output)
+// on one sequence; safe to call from several threads at the same time as long as each call gets a detector of its own.
+// Each call builds its own pool of nThreads workers for the tasks within a frame (0 = no. of hardware cores)
+void processSequence(const SequenceConfig &config, ObjectDetector &objectDetector, size_t nThreads, SequenceResult &result);
+
+#endif /* sequenceProcessor_hpp */
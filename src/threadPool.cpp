@@ -0,0 +1,108 @@
+#include "threadPool.hpp"
+
+using namespace std;
+
+ThreadPool::ThreadPool(size_t nThreads) : task(nullptr), nTasks(0), nextTask(0), generation(0), nBusy(0), bStop(false)
+{
+    if (nThreads == 0)
+    {
+        nThreads = max(1u, thread::hardware_concurrency());
+    }
+
+    // the calling thread takes part in every loop, so one thread less needs to be started
+    for (size_t i = 1; i < nThreads; ++i)
+    {
+        workers.push_back(thread(&ThreadPool::workerLoop, this));
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        lock_guard<mutex> lock(mtx);
+        bStop = true;
+    }
+    cvStart.notify_all();
+
+    for (auto it = workers.begin(); it != workers.end(); ++it)
+    {
+        it->join();
+    }
+}
+
+void ThreadPool::parallelFor(size_t n, const std::function<void(size_t)> &task)
+{
+    // avoid the synchronization overhead when there is nothing to distribute
+    if (workers.empty() || n < 2)
+    {
+        for (size_t i = 0; i < n; ++i)
+        {
+            task(i);
+        }
+        return;
+    }
+
+    {
+        lock_guard<mutex> lock(mtx);
+        this->task = &task;
+        nTasks = n;
+        nextTask = 0;
+        ++generation;
+    }
+    cvStart.notify_all();
+
+    runTasks(task, n);
+
+    // close the loop to workers which wake up only now, then wait for those still executing their last task
+    unique_lock<mutex> lock(mtx);
+    this->task = nullptr;
+    cvDone.wait(lock, [this]() { return nBusy == 0; });
+}
+
+size_t ThreadPool::size() const
+{
+    return workers.size() + 1;
+}
+
+void ThreadPool::workerLoop()
+{
+    size_t lastGeneration = 0;
+    unique_lock<mutex> lock(mtx);
+    while (true)
+    {
+        cvStart.wait(lock, [&]() { return bStop || generation != lastGeneration; });
+        if (bStop)
+        {
+            return;
+        }
+        lastGeneration = generation;
+        if (task == nullptr)
+        {
+            continue; // the loop has already been finished by the other threads
+        }
+
+        // the loop state is read under the lock, the next loop can only start once this worker has left it
+        const std::function<void(size_t)> *loopTask = task;
+        size_t loopSize = nTasks;
+        ++nBusy;
+
+        lock.unlock();
+        runTasks(*loopTask, loopSize);
+        lock.lock();
+
+        if (--nBusy == 0)
+        {
+            cvDone.notify_one();
+        }
+    }
+}
+
+void ThreadPool::runTasks(const std::function<void(size_t)> &loopTask, size_t loopSize)
+{
+    // tasks are handed out one index at a time, which balances boxes with very different point counts
+    size_t i;
+    while ((i = nextTask.fetch_add(1)) < loopSize)
+    {
+        loopTask(i);
+    }
+}
@@ -0,0 +1,41 @@
+
+#ifndef threadPool_hpp
+#define threadPool_hpp
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// fixed set of worker threads which is created once and re-used for data-parallel loops
+class ThreadPool
+{
+public:
+    explicit ThreadPool(size_t nThreads = 0); // 0 = no. of hardware cores
+    ~ThreadPool();
+
+    // run task(i) for all i in [0, n) on the workers and the calling thread, returns when all tasks are finished;
+    // tasks must only write to data owned by their index so that results do not depend on the no. of threads
+    void parallelFor(size_t n, const std::function<void(size_t)> &task);
+    size_t size() const; // no. of threads taking part in a loop, including the calling thread
+
+private:
+    void workerLoop();
+    void runTasks(const std::function<void(size_t)> &loopTask, size_t loopSize);
+
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable cvStart; // signals a new loop (or shutdown) to the workers
+    std::condition_variable cvDone;  // signals the calling thread that all workers have left the loop
+
+    const std::function<void(size_t)> *task; // task of the current loop, nullptr once the loop is closed to new workers
+    size_t nTasks;
+    std::atomic<size_t> nextTask;
+    size_t generation; // incremented for every loop so that workers join each loop exactly once
+    size_t nBusy;      // no. of workers currently executing tasks
+    bool bStop;
+};
+
+#endif /* threadPool_hpp */
@@ -0,0 +1,309 @@
+#include <cmath>
+#include <climits>
+#include <algorithm>
+
+#include "trackManager.hpp"
+
+using namespace std;
+
+TrackManager::TrackManager(double minGateIoU, double smoothingFactor, int maxMisses)
+    : minGateIoU(minGateIoU), smoothingFactor(smoothingFactor), maxMisses(maxMisses), nextTrackID(0)
+{
+}
+
+// intersection over union of two rectangles
+static double computeIoU(const cv::Rect &a, const cv::Rect &b)
+{
+    double intersection = (a & b).area();
+    double unionArea = a.area() + b.area() - intersection;
+    return unionArea > 0 ? intersection / unionArea : 0.0;
+}
+
+// last observed roi shifted to the next frame according to the constant-velocity model
+static cv::Rect predictRoi(const Track &track, double dT)
+{
+    cv::Rect roi = track.roi;
+    roi.x += (int)round(track.velocity.x * (track.tSinceObserved + dT));
+    roi.y += (int)round(track.velocity.y * (track.tSinceObserved + dT));
+    return roi;
+}
+
+// coarse grid over the extent of the predicted track rois
+struct TrackGrid {
+    cv::Rect extent;
+    int cols, rows;
+    int cellWidth, cellHeight;
+};
+
+static const int gridCellSize = 64; // nominal edge length of a grid cell in pixels
+static const int maxGridCells = 32; // max. no. of cells along each axis, larger extents get larger cells
+
+// range of grid cells overlapped by roi, false if roi lies outside of the grid
+static bool findCells(const TrackGrid &grid, const cv::Rect &roi, int &col0, int &col1, int &row0, int &row1)
+{
+    cv::Rect r = roi & grid.extent;
+    if (r.area() <= 0)
+    {
+        return false;
+    }
+    col0 = (r.x - grid.extent.x) / grid.cellWidth;
+    col1 = (r.x + r.width - 1 - grid.extent.x) / grid.cellWidth;
+    row0 = (r.y - grid.extent.y) / grid.cellHeight;
+    row1 = (r.y + r.height - 1 - grid.extent.y) / grid.cellHeight;
+    return true;
+}
+
+// blend a new TTC measurement into the smoothed value, which itself decreases by dT between frames
+static void updateTTC(double &ttc, double measurement, double dT, double smoothingFactor)
+{
+    if (!std::isfinite(measurement))
+    {
+        if (std::isfinite(ttc))
+        {
+            ttc -= dT;
+        }
+        return;
+    }
+
+    ttc = std::isfinite(ttc) ? smoothingFactor * measurement + (1 - smoothingFactor) * (ttc - dT) : measurement;
+}
+
+void TrackManager::update(const std::vector<BoundingBox> &prevBoxes, std::vector<BoundingBox> &currBoxes, const std::vector<std::pair<int, int>> &bbMatches,
+                          const std::vector<TTCResult> &ttcResults, double dT)
+{
+    // index the bounding box matches by previous box
+    matchOfPrevBox.assign(prevBoxes.size(), -1);
+    for (auto it = bbMatches.begin(); it != bbMatches.end(); ++it)
+    {
+        matchOfPrevBox[it->first] = it->second;
+    }
+
+    // predict the roi of every live track (including tracks which are coasting without detection) into the current
+    // frame and bucket the tracks in the grid cells their predicted roi overlaps
+    TrackGrid grid;
+    int xMin = INT_MAX, yMin = INT_MAX, xMax = INT_MIN, yMax = INT_MIN;
+    for (auto it = tracks.begin(); it != tracks.end(); ++it)
+    {
+        it->predictedRoi = predictRoi(*it, dT);
+        xMin = min(xMin, it->predictedRoi.x);
+        yMin = min(yMin, it->predictedRoi.y);
+        xMax = max(xMax, it->predictedRoi.x + it->predictedRoi.width);
+        yMax = max(yMax, it->predictedRoi.y + it->predictedRoi.height);
+    }
+    grid.extent = tracks.empty() ? cv::Rect() : cv::Rect(xMin, yMin, xMax - xMin, yMax - yMin);
+    grid.cols = min(maxGridCells, max(1, (grid.extent.width + gridCellSize - 1) / gridCellSize));
+    grid.rows = min(maxGridCells, max(1, (grid.extent.height + gridCellSize - 1) / gridCellSize));
+    grid.cellWidth = max(1, (grid.extent.width + grid.cols - 1) / grid.cols);
+    grid.cellHeight = max(1, (grid.extent.height + grid.rows - 1) / grid.rows);
+
+    // count the tracks per cell, turn the counts into start offsets and fill in the tracks
+    int col0, col1, row0, row1;
+    cellStart.assign(grid.cols * grid.rows + 1, 0);
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        if (findCells(grid, tracks[i].predictedRoi, col0, col1, row0, row1))
+        {
+            for (int row = row0; row <= row1; ++row)
+            {
+                for (int col = col0; col <= col1; ++col)
+                {
+                    ++cellStart[row * grid.cols + col + 1];
+                }
+            }
+        }
+    }
+    for (size_t c = 1; c < cellStart.size(); ++c)
+    {
+        cellStart[c] += cellStart[c - 1];
+    }
+    cellTracks.resize(cellStart.back());
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        if (findCells(grid, tracks[i].predictedRoi, col0, col1, row0, row1))
+        {
+            for (int row = row0; row <= row1; ++row)
+            {
+                for (int col = col0; col <= col1; ++col)
+                {
+                    cellTracks[cellStart[row * grid.cols + col]++] = (int)i;
+                }
+            }
+        }
+    }
+    for (size_t c = cellStart.size() - 1; c > 0; --c) // filling advanced each start to the start of the next cell
+    {
+        cellStart[c] = cellStart[c - 1];
+    }
+    cellStart[0] = 0;
+
+    // gate each box against the tracks in the cells it overlaps : a candidate needs the same class and a min. overlap
+    // with the predicted roi, so only tracks which share a cell with the box can pass
+    candidates.clear();
+    lastGatedBoxOfTrack.assign(tracks.size(), -1);
+    for (size_t j = 0; j < currBoxes.size(); ++j)
+    {
+        if (!findCells(grid, currBoxes[j].roi, col0, col1, row0, row1))
+        {
+            continue;
+        }
+        for (int row = row0; row <= row1; ++row)
+        {
+            for (int col = col0; col <= col1; ++col)
+            {
+                int cell = row * grid.cols + col;
+                for (int k = cellStart[cell]; k < cellStart[cell + 1]; ++k)
+                {
+                    int i = cellTracks[k];
+                    if (lastGatedBoxOfTrack[i] == (int)j || currBoxes[j].classID != tracks[i].classID)
+                    {
+                        continue;
+                    }
+                    lastGatedBoxOfTrack[i] = (int)j;
+
+                    double iou = computeIoU(tracks[i].predictedRoi, currBoxes[j].roi);
+                    if (iou >= minGateIoU)
+                    {
+                        int matchedBox = tracks[i].boxID >= 0 && tracks[i].boxID < (int)prevBoxes.size() ? matchOfPrevBox[tracks[i].boxID] : -1;
+                        Candidate candidate = {i, (int)j, iou, matchedBox == (int)j};
+                        candidates.push_back(candidate);
+                    }
+                }
+            }
+        }
+    }
+    for (auto it = tracks.begin(); it != tracks.end(); ++it)
+    {
+        it->boxID = -1;
+    }
+
+    // greedy one-to-one assignment in order of decreasing overlap, a supporting bounding box match wins ties
+    sort(candidates.begin(), candidates.end(), [](const Candidate &a, const Candidate &b) {
+        if (a.iou != b.iou)
+        {
+            return a.iou > b.iou;
+        }
+        if (a.bMatched != b.bMatched)
+        {
+            return a.bMatched;
+        }
+        return a.iTrack != b.iTrack ? a.iTrack < b.iTrack : a.iBox < b.iBox;
+    });
+    trackOfCurrBox.assign(currBoxes.size(), -1);
+    for (auto it = candidates.begin(); it != candidates.end(); ++it)
+    {
+        if (trackOfCurrBox[it->iBox] < 0 && tracks[it->iTrack].boxID < 0)
+        {
+            trackOfCurrBox[it->iBox] = it->iTrack;
+            tracks[it->iTrack].boxID = currBoxes[it->iBox].boxID;
+        }
+    }
+
+    // update associated tracks
+    for (size_t j = 0; j < currBoxes.size(); ++j)
+    {
+        int iTrack = trackOfCurrBox[j];
+        if (iTrack < 0)
+        {
+            continue;
+        }
+
+        // velocity from the motion between the last and the current observation, which may be several frames apart
+        Track &track = tracks[iTrack];
+        const cv::Rect &roi = currBoxes[j].roi;
+        double tObserved = track.tSinceObserved + dT;
+        cv::Point2f centerShift((roi.x + roi.width / 2.0f) - (track.roi.x + track.roi.width / 2.0f),
+                                (roi.y + roi.height / 2.0f) - (track.roi.y + track.roi.height / 2.0f));
+        cv::Point2f measuredVelocity(centerShift.x / tObserved, centerShift.y / tObserved);
+        track.velocity = track.nHits > 1 ? cv::Point2f(0.5f * (track.velocity.x + measuredVelocity.x), 0.5f * (track.velocity.y + measuredVelocity.y))
+                                         : measuredVelocity;
+        track.roi = roi;
+        track.predictedRoi = roi;
+        track.tSinceObserved = 0.0;
+        ++track.nHits;
+        track.nMisses = 0;
+    }
+
+    // fold TTC measurements into the tracks, at most one per track and frame
+    ttcUpdatedOfTrack.assign(tracks.size(), 0);
+    for (auto it = ttcResults.begin(); it != ttcResults.end(); ++it)
+    {
+        int iTrack = trackOfCurrBox[it->boxID];
+        if (iTrack >= 0 && !ttcUpdatedOfTrack[iTrack])
+        {
+            updateTTC(tracks[iTrack].ttcLidar, it->ttcLidar, dT, smoothingFactor);
+            updateTTC(tracks[iTrack].ttcCamera, it->ttcCamera, dT, smoothingFactor);
+            ttcUpdatedOfTrack[iTrack] = 1;
+        }
+    }
+
+    // predict tracks without detection or measurement and remove tracks which have been lost for too long
+    size_t nKeep = 0;
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        Track &track = tracks[i];
+        if (!ttcUpdatedOfTrack[i])
+        {
+            updateTTC(track.ttcLidar, NAN, dT, smoothingFactor);
+            updateTTC(track.ttcCamera, NAN, dT, smoothingFactor);
+        }
+        if (track.boxID < 0)
+        {
+            // the last observed roi is kept, predictedRoi already holds the prediction for this frame
+            track.tSinceObserved += dT;
+            ++track.nMisses;
+        }
+
+        if (track.nMisses <= maxMisses)
+        {
+            tracks[nKeep++] = track;
+        }
+    }
+    tracks.resize(nKeep);
+
+    // start new tracks for unassociated boxes
+    for (size_t j = 0; j < currBoxes.size(); ++j)
+    {
+        if (trackOfCurrBox[j] >= 0)
+        {
+            continue;
+        }
+
+        Track track;
+        track.trackID = nextTrackID++;
+        track.classID = currBoxes[j].classID;
+        track.boxID = currBoxes[j].boxID;
+        track.roi = currBoxes[j].roi;
+        track.tSinceObserved = 0.0;
+        track.predictedRoi = track.roi;
+        track.velocity = cv::Point2f(0, 0);
+        track.ttcLidar = track.ttcCamera = NAN;
+        track.nHits = 1;
+        track.nMisses = 0;
+        tracks.push_back(track);
+    }
+
+    // write identities into the boxes and index the tracks by current box for lookups
+    trackOfCurrBox.assign(currBoxes.size(), -1);
+    for (size_t i = 0; i < tracks.size(); ++i)
+    {
+        if (tracks[i].boxID >= 0)
+        {
+            trackOfCurrBox[tracks[i].boxID] = (int)i;
+            currBoxes[tracks[i].boxID].trackID = tracks[i].trackID;
+        }
+    }
+}
+
+const std::vector<Track> &TrackManager::getTracks() const
+{
+    return tracks;
+}
+
+const Track *TrackManager::findTrackByBox(int boxID) const
+{
+    if (boxID < 0 || boxID >= (int)trackOfCurrBox.size() || trackOfCurrBox[boxID] < 0)
+    {
+        return nullptr;
+    }
+    return &tracks[trackOfCurrBox[boxID]];
+}
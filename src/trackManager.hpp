@@ -0,0 +1,65 @@
+
+#ifndef trackManager_hpp
+#define trackManager_hpp
+
+#include <stdio.h>
+#include <vector>
+#include <utility>
+#include <opencv2/core.hpp>
+
+#include "dataStructures.h"
+
+struct Track { // compact state of an object which is followed over several frames
+
+    int trackID; // unique identifier, copied into BoundingBox::trackID of the associated boxes
+    int classID; // class of the first associated detection
+    int boxID; // associated bounding box in the most recent frame, -1 if the object was not detected
+    cv::Rect roi; // 2D region-of-interest of the last associated detection
+    double tSinceObserved; // time since roi was observed in [s], 0 if the object was detected in the most recent frame
+    cv::Rect predictedRoi; // roi shifted to the most recent frame by the motion model
+    cv::Point2f velocity; // motion of the roi center in pixels per second (constant-velocity model)
+    double ttcLidar; // smoothed TTC based on Lidar in [s], NaN until the first valid measurement
+    double ttcCamera; // smoothed TTC based on camera in [s], NaN until the first valid measurement
+    int nHits; // no. of frames in which the object was detected
+    int nMisses; // no. of consecutive frames without detection
+};
+
+// keeps persistent object identities across frames and updates their state incrementally; the predicted track rois
+// are bucketed in a coarse image grid, so that for objects spread over the image an update costs O(tracks + detections)
+class TrackManager
+{
+public:
+    TrackManager(double minGateIoU, double smoothingFactor, int maxMisses);
+
+    // associate the boxes of the current frame with existing tracks (each box is gated against the tracks whose predicted
+    // roi shares a grid cell with it, the bounding box matches between previous and current frame only break ties),
+    // assign BoundingBox::trackID and fold at most one new TTC measurement per track into the tracks
+    void update(const std::vector<BoundingBox> &prevBoxes, std::vector<BoundingBox> &currBoxes, const std::vector<std::pair<int, int>> &bbMatches,
+                const std::vector<TTCResult> &ttcResults, double dT);
+
+    const std::vector<Track> &getTracks() const;
+    const Track *findTrackByBox(int boxID) const; // track associated with a box of the most recent frame, nullptr if none
+
+private:
+    struct Candidate { // track and box which pass the gate
+        int iTrack, iBox;
+        double iou;
+        bool bMatched; // box pair also associated by the bounding box matches
+    };
+
+    std::vector<Track> tracks;
+    std::vector<int> matchOfPrevBox; // current box matched to each box of the previous frame, -1 if none
+    std::vector<int> trackOfCurrBox; // track index for each box of the current frame, -1 if none
+    std::vector<Candidate> candidates;
+    std::vector<int> cellStart;        // grid cell c holds the tracks cellTracks[cellStart[c]] ... cellTracks[cellStart[c + 1] - 1]
+    std::vector<int> cellTracks;
+    std::vector<int> lastGatedBoxOfTrack; // last box gated against each track, so that a track is visited once per box
+    std::vector<char> ttcUpdatedOfTrack; // flags tracks which received a TTC measurement in the current frame
+
+    double minGateIoU; // min. overlap between predicted track roi and candidate box for an association
+    double smoothingFactor; // weight of a new TTC measurement in [0, 1]
+    int maxMisses; // tracks which were not detected for more frames are removed
+    int nextTrackID;
+};
+
+#endif /* trackManager_hpp */